@@ -0,0 +1,259 @@
+import argparse
+import heapq
+import json
+import math
+import os
+import random
+import re
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "neo4j"))
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "rabbitmq"))
+from dataset_catalog import DatasetCatalog
+
+DATASET_CATALOG_PATH = "../datasets.json"
+WORKSPACE_ROOT = "benchmark_workspaces"
+TACHOSDB_EXEC_PATH = os.path.abspath("../cmake-build-release/mydb2")
+TACHOSDB_RESULTS_PATH = "TachosDB_results.txt"
+TACHOSDB_STATS_PATH = "TachosDB_stats.txt"
+NUM_LEVELS = 4
+WORKLOADS = ("random", "hub", "clustered")
+
+
+def load_adjacency(csv_path):
+    """Read a FromNodeId\\tToNodeId edge list into a forward adjacency dict"""
+    adjacency = {}
+    with open(csv_path, 'r') as f:
+        for line in f:
+            if line.startswith('#'):
+                continue
+            src, dst = map(int, line.split())
+            adjacency.setdefault(src, []).append(dst)
+    return adjacency
+
+
+def generate_workload(adjacency, kind, num_queries, seed_size, rng):
+    """
+    Seed sets for one workload kind:
+    - random: uniformly chosen buildings
+    - hub: buildings drawn proportionally to their out-degree, without replacement
+    - clustered: a random building plus its direct neighbours
+    Seed sets are capped at the number of buildings with connections.
+    """
+    nodes = sorted(adjacency)
+    degrees = [len(adjacency[node]) for node in nodes]
+    seed_size = min(seed_size, len(nodes))
+    workload = []
+    for _ in range(num_queries):
+        if kind == "random":
+            seeds = rng.sample(nodes, seed_size)
+        elif kind == "hub":
+            # Weighted sampling without replacement: the seed_size smallest keys -log(u) / weight
+            keys = ((-math.log(1.0 - rng.random()) / degree, node) for node, degree in zip(nodes, degrees))
+            seeds = [node for _, node in heapq.nsmallest(seed_size, keys)]
+        else:
+            center = rng.choice(nodes)
+            neighbours = adjacency[center]
+            seeds = [center] + rng.sample(neighbours, min(seed_size - 1, len(neighbours)))
+        workload.append(sorted(seeds))
+    return workload
+
+
+def parse_levels(content):
+    """Parse one result file (one bracketed list of IDs per level) into a list of ID sets"""
+    return [set(map(int, re.findall(r'-?\d+', line))) for line in content.splitlines() if '[' in line]
+
+
+def percentile(values, q):
+    """Nearest-rank percentile"""
+    ordered = sorted(values)
+    return ordered[max(0, math.ceil(q / 100 * len(ordered)) - 1)]
+
+
+def summarize(samples_us):
+    if not samples_us:
+        return None
+    return {
+        "count": len(samples_us),
+        "p50_us": percentile(samples_us, 50),
+        "p95_us": percentile(samples_us, 95),
+        "p99_us": percentile(samples_us, 99),
+        "mean_us": sum(samples_us) / len(samples_us),
+    }
+
+
+def serial_throughput(samples_us):
+    """Queries per second of one client replaying a phase back to back: runs over their summed wall clock"""
+    total_us = sum(samples_us)
+    return len(samples_us) * 1e6 / total_us if total_us else None
+
+
+class TachosDBRunner:
+    """Runs mydb2 inside a catalog workspace; each run is one process, as in the service"""
+
+    def __init__(self, catalog, dataset):
+        self.catalog = catalog
+        self.snapshot = catalog.acquire(dataset)
+
+    def run(self, seeds):
+        with open(self.snapshot.input_path(0), 'w') as f:
+            f.write(str(seeds))
+
+        start_time = time.perf_counter()
+        subprocess.run([TACHOSDB_EXEC_PATH], cwd=self.snapshot.run_dir(0), check=True,
+                       stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+        wall_time_us = (time.perf_counter() - start_time) * 1e6
+
+        with open(os.path.join(self.snapshot.run_dir(0), TACHOSDB_STATS_PATH), 'r') as f:
+            stats = f.read()
+        with open(os.path.join(self.snapshot.run_dir(0), TACHOSDB_RESULTS_PATH), 'r') as f:
+            levels = parse_levels(f.read())
+
+        level_times = {int(level): int(us) for level, us in re.findall(r'Query (\d+) Execution Time: (\d+) us', stats)}
+        return levels, level_times, wall_time_us
+
+    def close(self):
+        self.catalog.release(self.snapshot)
+
+
+class Neo4jRunner:
+    """
+    Runs the level queries over one long-lived driver; cold runs clear the
+    query caches first. A level's time is the server-side
+    result_available_after + result_consumed_after: the queries aggregate
+    eagerly, so the traversal itself happens before the first row is available.
+    """
+
+    def __init__(self):
+        from neo4j import GraphDatabase
+        from neo4j_auth import URI, USERNAME, PASSWORD
+        from execute_prop_query import build_level_query
+        self.driver = GraphDatabase.driver(URI, auth=(USERNAME, PASSWORD))
+        self.queries = [build_level_query(level, "forward") for level in range(1, NUM_LEVELS + 1)]
+
+    def run(self, seeds, cold):
+        levels = [set(seeds)]
+        level_times = {}
+        start_time = time.perf_counter()
+        with self.driver.session(database="neo4j") as session:
+            for level, query in enumerate(self.queries, start=1):
+                if cold:
+                    session.run("CALL db.clearQueryCaches()").consume()
+                result = session.run(query, input_values=seeds)
+                nodes = set()
+                for record in result:
+                    nodes.update(record["nodes"])
+                summary = result.consume()
+                level_times[level] = (summary.result_available_after + summary.result_consumed_after) * 1000
+                levels.append(nodes)
+        return levels, level_times, (time.perf_counter() - start_time) * 1e6
+
+    def close(self):
+        self.driver.close()
+
+
+def run_benchmark(dataset, workloads, num_queries, seed_size, repeats, engines, rng_seed):
+    catalog = DatasetCatalog(DATASET_CATALOG_PATH, WORKSPACE_ROOT)
+    snapshot = catalog.acquire(dataset)
+    adjacency = load_adjacency(snapshot.paths["csv"])
+    catalog.release(snapshot)
+
+    runners = {}
+    if "tachosdb" in engines:
+        runners["tachosdb"] = TachosDBRunner(catalog, dataset)
+    if "neo4j" in engines:
+        runners["neo4j"] = Neo4jRunner()
+
+    rng = random.Random(rng_seed)
+    # samples[workload][engine][phase]["level"|"end_to_end"] -> latencies in us
+    samples = {}
+    mismatches = {kind: {level: 0 for level in range(NUM_LEVELS + 1)} for kind in workloads}
+
+    try:
+        for kind in workloads:
+            workload = generate_workload(adjacency, kind, num_queries, seed_size, rng)
+            samples[kind] = {engine: {"cold": {}, "warm": {}} for engine in runners}
+
+            for seeds in workload:
+                results = {}
+                # The first run of a seed set is cold, the following repeats are warm
+                for repeat in range(repeats + 1):
+                    phase = "cold" if repeat == 0 else "warm"
+                    for engine, runner in runners.items():
+                        if engine == "neo4j":
+                            levels, level_times, wall_us = runner.run(seeds, cold=repeat == 0)
+                        else:
+                            levels, level_times, wall_us = runner.run(seeds)
+                        results[engine] = levels
+
+                        phase_samples = samples[kind][engine][phase]
+                        phase_samples.setdefault("end_to_end", []).append(wall_us)
+                        for level, us in level_times.items():
+                            phase_samples.setdefault(f"level_{level}", []).append(us)
+
+                # Correctness is checked level by level between the two engines
+                if len(results) == 2:
+                    for level, (expected, actual) in enumerate(zip(results["neo4j"], results["tachosdb"])):
+                        if expected != actual:
+                            mismatches[kind][level] += 1
+
+            print(f"Finished {kind} workload ({len(workload)} seed sets)")
+    finally:
+        for runner in runners.values():
+            runner.close()
+
+    report = {
+        "dataset": dataset,
+        "queries_per_workload": num_queries,
+        "seed_size": seed_size,
+        "warm_repeats": repeats,
+        "workloads": {},
+    }
+    for kind in workloads:
+        report["workloads"][kind] = {
+            "mismatched_seed_sets_per_level": mismatches[kind] if len(runners) == 2 else None,
+            "engines": {
+                engine: {phase: {"latency": {name: summarize(values) for name, values in sorted(phase_samples.items())},
+                                 "serial_throughput_qps": serial_throughput(phase_samples.get("end_to_end", []))}
+                         for phase, phase_samples in phases.items()}
+                for engine, phases in samples[kind].items()
+            },
+        }
+    return report
+
+
+def print_report(report):
+    for kind, workload in report["workloads"].items():
+        print(f"\n=== {kind} workload ===")
+        for engine, phases in workload["engines"].items():
+            for phase, metrics in phases.items():
+                for name, summary in metrics["latency"].items():
+                    if summary:
+                        print(f"{engine:9s} {phase:5s} {name:11s} p50 {summary['p50_us']:>10.0f} us  "
+                              f"p95 {summary['p95_us']:>10.0f} us  p99 {summary['p99_us']:>10.0f} us")
+                if metrics["serial_throughput_qps"]:
+                    print(f"{engine:9s} {phase:5s} serial throughput {metrics['serial_throughput_qps']:.1f} q/s")
+        if workload["mismatched_seed_sets_per_level"] is not None:
+            print(f"Mismatched seed sets per level: {workload['mismatched_seed_sets_per_level']}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Replay a propagation workload against Neo4j and TachosDB")
+    parser.add_argument("--dataset", default=None, help="catalog dataset name (default dataset if omitted)")
+    parser.add_argument("--workloads", default=",".join(WORKLOADS), help=f"comma-separated subset of {WORKLOADS}")
+    parser.add_argument("--queries", type=int, default=20, help="seed sets per workload")
+    parser.add_argument("--seed-size", type=int, default=5)
+    parser.add_argument("--repeats", type=int, default=3, help="warm runs per seed set after the cold one")
+    parser.add_argument("--engines", default="neo4j,tachosdb")
+    parser.add_argument("--rng-seed", type=int, default=0)
+    parser.add_argument("--output", default="workload_benchmark.json")
+    args = parser.parse_args()
+
+    report = run_benchmark(args.dataset, args.workloads.split(","), args.queries, args.seed_size, args.repeats,
+                           args.engines.split(","), args.rng_seed)
+    print_report(report)
+    with open(args.output, 'w') as f:
+        json.dump(report, f, indent=2)
+    print(f"\nReport saved to {args.output}")
@@ -0,0 +1,28 @@
+import json
+import os
+
+# The dataset catalog sits at the repository root, next to this module
+DATASET_CATALOG_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "datasets.json")
+
+
+def dataset_entry(name=None):
+    """
+    Look up (name, entry, default) of a catalog dataset (the default one if
+    name is None), with the entry's csv and serialized paths made absolute
+    """
+    with open(DATASET_CATALOG_PATH, 'r') as f:
+        catalog = json.load(f)
+    name = name or catalog["default"]
+    if name not in catalog["datasets"]:
+        raise KeyError(f"Unknown dataset '{name}', known datasets: {', '.join(catalog['datasets'])}")
+    entry = dict(catalog["datasets"][name])
+    for kind in ("csv", "serialized"):
+        if kind in entry:
+            entry[kind] = os.path.join(os.path.dirname(DATASET_CATALOG_PATH), entry[kind])
+    return name, entry, catalog["default"]
+
+
+def resolve_dataset(name=None):
+    """Look up (serialized_dir, num_nodes) of a catalog dataset (the default one if name is None)"""
+    _, entry, _ = dataset_entry(name)
+    return entry["serialized"], entry["num_nodes"]
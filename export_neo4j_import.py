@@ -0,0 +1,107 @@
+import argparse
+import os
+import re
+import subprocess
+from concurrent.futures import ProcessPoolExecutor
+import numpy as np
+from catalog_lookup import dataset_entry
+from serialized_dataset import find_chunks, read_chunk
+
+# Header files of the neo4j-admin import; the data parts carry no header.
+# With --id-type=INTEGER the :ID column is also stored as the integer `id`
+# property the propagation queries match on.
+NODES_HEADER = "id:ID(Building)"
+RELATIONSHIPS_HEADER = ":START_ID(Building),:END_ID(Building)"
+
+# Every file an export writes; only these are removed when re-exporting into the same directory
+EXPORT_FILE_PATTERN = re.compile(r"(nodes|relationships)_(header|\d+_\d+)\.csv")
+
+
+def _export_chunk(task):
+    """
+    Write the CONNECTED_TO rows of one forward chunk. A chunk holds every
+    out-edge of its node range, so deduplicating within it is global. Returns
+    the IDs of the buildings the chunk's edges touch.
+    """
+    lo, hi, chunk_path, output_dir = task
+    counts, neighbours = read_chunk(chunk_path, lo, hi)
+    sources = np.repeat(np.arange(lo, hi, dtype=np.int64), counts)
+
+    edges = np.unique(np.stack((sources, neighbours), axis=1), axis=0)
+    np.savetxt(os.path.join(output_dir, f"relationships_{lo}_{hi}.csv"), edges, fmt="%d", delimiter=",")
+    return np.union1d(edges[:, 0], edges[:, 1])
+
+
+def _export_nodes(task):
+    lo, hi, nodes, output_dir = task
+    np.savetxt(os.path.join(output_dir, f"nodes_{lo}_{hi}.csv"), nodes, fmt="%d")
+
+
+def export_bulk_import(serialized_dir, num_nodes, output_dir, workers=None):
+    """
+    Turn the serialized forward chunks of a dataset into neo4j-admin import
+    CSVs: one deduplicated relationship part per chunk and one node part per
+    chunk range, holding every building that has at least one connection
+    (the same set the MERGE-based loader creates).
+    """
+    chunks = find_chunks(serialized_dir, "fwd", num_nodes)
+    os.makedirs(output_dir, exist_ok=True)
+    # Parts of a previous export with other chunk bounds would still match the import regexes
+    for name in os.listdir(output_dir):
+        if EXPORT_FILE_PATTERN.fullmatch(name):
+            os.remove(os.path.join(output_dir, name))
+
+    with open(os.path.join(output_dir, "nodes_header.csv"), 'w') as f:
+        f.write(NODES_HEADER + "\n")
+    with open(os.path.join(output_dir, "relationships_header.csv"), 'w') as f:
+        f.write(RELATIONSHIPS_HEADER + "\n")
+
+    connected = np.zeros(num_nodes, dtype=bool)
+    with ProcessPoolExecutor(max_workers=workers or os.cpu_count()) as pool:
+        tasks = [(lo, hi, path, output_dir) for lo, hi, path in chunks]
+        for touched in pool.map(_export_chunk, tasks):
+            connected[touched] = True
+
+        tasks = [(lo, hi, np.flatnonzero(connected[lo:hi]) + lo, output_dir) for lo, hi, _ in chunks]
+        list(pool.map(_export_nodes, tasks))
+
+    print(f"Exported {int(connected.sum())} buildings and {len(chunks)} relationship parts to {output_dir}")
+
+
+def import_command(output_dir, database="neo4j"):
+    """neo4j-admin invocation loading an exported directory; Neo4j must be stopped while it runs"""
+    # Each file group is its header followed by a regex matching all of its parts
+    nodes = ",".join(os.path.join(output_dir, name) for name in ("nodes_header.csv", r"nodes_\d+_\d+\.csv"))
+    relationships = ",".join(os.path.join(output_dir, name)
+                             for name in ("relationships_header.csv", r"relationships_\d+_\d+\.csv"))
+    return [
+        "neo4j-admin", "database", "import", "full", database,
+        "--overwrite-destination=true",
+        "--id-type=INTEGER",
+        f"--nodes=Building={nodes}",
+        f"--relationships=CONNECTED_TO={relationships}",
+    ]
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Export a serialized dataset as neo4j-admin import CSVs")
+    parser.add_argument("--dataset", default=None, help="catalog dataset name (default dataset if omitted)")
+    parser.add_argument("--output", default="neo4j_import")
+    parser.add_argument("--workers", type=int, default=None)
+    parser.add_argument("--import", dest="run_import", action="store_true",
+                        help="run neo4j-admin import afterwards (stop Neo4j first)")
+    args = parser.parse_args()
+
+    name, entry, default = dataset_entry(args.dataset)
+    if args.run_import and name != default:
+        # The graph service assumes Neo4j holds the default dataset (see push_data_to_db.py)
+        parser.error(f"only the default dataset '{default}' can be imported into Neo4j")
+    serialized_dir, num_nodes = entry["serialized"], entry["num_nodes"]
+    output_dir = os.path.abspath(args.output)
+    export_bulk_import(serialized_dir, num_nodes, output_dir, args.workers)
+
+    command = import_command(output_dir)
+    if args.run_import:
+        subprocess.run(command, check=True)
+    else:
+        print("Load it with Neo4j stopped:\n" + " ".join(f"'{part}'" if "\\" in part else part for part in command))
@@ -1,5 +1,18 @@
+import argparse
+import math
+import os
 import random
+import shutil
+import tempfile
+from concurrent.futures import ProcessPoolExecutor
 import numpy as np
+from serialized_dataset import chunk_bounds, write_chunk
+
+# Quadrant probabilities (a, b, c, d) of the R-MAT recursive matrix model
+RMAT_PROBABILITIES = (0.57, 0.19, 0.19, 0.05)
+
+# Upper bound on edges generated per work unit, to keep each worker's memory bounded
+MAX_EDGES_PER_CHUNK = 1 << 24
 
 def generate_graph_dataset(max_node_id=4096, min_degree=10, max_degree=96, node_probability=0.1, output_file="data.txt"):
     """
@@ -67,5 +80,260 @@ def generate_graph_dataset(max_node_id=4096, min_degree=10, max_degree=96, node_
             node = random.choice(active_nodes)
             print(f"Node {node} has {degrees[node]} connections")
 
+def _rmat_edges(rng, lo, hi, num_nodes, num_edges):
+    """
+    Draw R-MAT edges whose source lies in [lo, hi). The source bit of every
+    level is independent (1 with probability c + d), and the destination bit
+    only depends on the source bit of the same level, so sources can be drawn
+    first and destinations conditioned on them. The chunk's edge count is
+    Poisson with the chunk's share of the source probability mass.
+    """
+    a, b, c, d = RMAT_PROBABILITIES
+    scale = int(math.log2(num_nodes))
+
+    chunk_mass = _rmat_prefix_mass(hi, scale, c + d) - _rmat_prefix_mass(lo, scale, c + d)
+    num_chunk_edges = int(rng.poisson(num_edges * chunk_mass))
+    src = _rmat_range_sources(rng, lo, hi, scale, c + d, num_chunk_edges)
+
+    dst = np.zeros(num_chunk_edges, dtype=np.int64)
+    for level in range(scale):
+        src_bit = (src >> level) & 1
+        dst_one = np.where(src_bit == 1, d / (c + d), b / (a + b))
+        dst |= (rng.random(num_chunk_edges) < dst_one).astype(np.int64) << level
+    return src, dst
+
+
+def _rmat_range_sources(rng, lo, hi, scale, p_one, size):
+    """
+    Draw size R-MAT sources conditioned on lying in [lo, hi), one bit at a
+    time from the highest. A bit picks between the two halves of the current
+    prefix's subtree in proportion to their mass inside the range. A half
+    entirely inside (or outside) the range keeps its whole (or no) mass, so
+    only the halves holding lo or hi need the prefix mass, and memory grows
+    with size rather than with the width of the range.
+    """
+    def covered(start, level):
+        """Share of the mass of [start, start + 2^level) that lies in [lo, hi)"""
+        end = start + (1 << level)
+        if start >= hi or end <= lo:
+            return 0.0
+        return (_rmat_prefix_mass(min(hi, end) - start, level, p_one)
+                - _rmat_prefix_mass(max(lo, start) - start, level, p_one))
+
+    src = np.zeros(size, dtype=np.int64)
+    for level in reversed(range(scale)):
+        weights = []
+        for half in (src, src | (1 << level)):
+            share = ((half >= lo) & (half + (1 << level) <= hi)).astype(np.float64)
+            for boundary in (lo, hi):
+                start = boundary >> level << level
+                share[half == start] = covered(start, level)
+            weights.append(share)
+        zero, one = (1 - p_one) * weights[0], p_one * weights[1]
+        src |= (rng.random(size) * (zero + one) < one).astype(np.int64) << level
+    return src
+
+
+def _rmat_prefix_mass(x, scale, p_one):
+    """
+    Probability that an R-MAT endpoint lies in [0, x) when each of its scale
+    bits is 1 with probability p_one: for every bit set in x, all IDs sharing
+    x's higher bits and having a 0 there are below x.
+    """
+    if x >= 1 << scale:
+        return 1.0
+    mass, high = 0.0, 1.0
+    for level in reversed(range(scale)):
+        if (x >> level) & 1:
+            mass += high * (1 - p_one)
+            high *= p_one
+        else:
+            high *= 1 - p_one
+    return mass
+
+
+def _rmat_chunk_bounds(num_nodes, num_edges, max_edges):
+    """
+    R-MAT concentrates edges on low IDs, so even ID ranges would give the first
+    chunk most of the graph. Cut greedily instead so that each chunk expects at
+    most max_edges source edges and as many destination edges (its fwd and bwd
+    files), a range holding a single heavier node being the only exception.
+    """
+    a, b, c, d = RMAT_PROBABILITIES
+    scale = num_nodes.bit_length() - 1
+
+    def expected_edges(lo, hi):
+        return num_edges * max(_rmat_prefix_mass(hi, scale, c + d) - _rmat_prefix_mass(lo, scale, c + d),
+                               _rmat_prefix_mass(hi, scale, b + d) - _rmat_prefix_mass(lo, scale, b + d))
+
+    bounds = []
+    lo = 0
+    while lo < num_nodes:
+        # Largest hi whose range stays within the cap; the mass only grows with hi
+        low, high = lo + 1, num_nodes
+        while low < high:
+            mid = (low + high + 1) // 2
+            if expected_edges(lo, mid) <= max_edges:
+                low = mid
+            else:
+                high = mid - 1
+        bounds.append((lo, low))
+        lo = low
+    return bounds
+
+
+def _powerlaw_edges(rng, lo, hi, num_nodes, avg_degree, gamma=2.5):
+    """
+    Power-law graph: out-degrees follow a Pareto law with exponent gamma, and
+    destinations are drawn from a Zipf-like rank law whose ranks are scattered
+    over the ID space by an affine permutation, so hubs land in every chunk.
+    """
+    x_min = avg_degree * (gamma - 2) / (gamma - 1)
+    degrees = np.floor(x_min * (1.0 - rng.random(hi - lo)) ** (-1.0 / (gamma - 1))).astype(np.int64)
+    degrees = np.minimum(degrees, num_nodes - 1)
+    src = np.repeat(np.arange(lo, hi, dtype=np.int64), degrees)
+
+    # Inverse CDF of a continuous rank density proportional to x^-beta on [1, num_nodes + 1)
+    beta = 1.0 / (gamma - 1)
+    span = (num_nodes + 1) ** (1 - beta) - 1
+    ranks = np.floor((1 + rng.random(src.size) * span) ** (1 / (1 - beta))).astype(np.int64) - 1
+    ranks = np.minimum(ranks, num_nodes - 1)
+
+    multiplier = 2654435761 % num_nodes or 1
+    while math.gcd(multiplier, num_nodes) != 1:
+        multiplier += 1
+    dst = (ranks * multiplier + num_nodes // 3) % num_nodes
+    return src, dst
+
+
+def _grid_edges(rng, lo, hi, num_nodes, avg_degree):
+    """
+    Spatial building grid: nodes sit on a square grid (id = y * width + x) and
+    connect to random nodes within a small neighbourhood, like a city block.
+    """
+    width = math.isqrt(num_nodes - 1) + 1
+    radius = max(1, math.ceil((math.sqrt(4 * avg_degree) - 1) / 2))
+    degrees = rng.integers(1, 2 * avg_degree, size=hi - lo, endpoint=False)
+    src = np.repeat(np.arange(lo, hi, dtype=np.int64), degrees)
+
+    x = src % width + rng.integers(-radius, radius, size=src.size, endpoint=True)
+    y = src // width + rng.integers(-radius, radius, size=src.size, endpoint=True)
+    keep = (x >= 0) & (x < width) & (y >= 0) & (y * width + x < num_nodes)
+    return src[keep], (y * width + x)[keep]
+
+
+def _generate_chunk(task):
+    """Generate, deduplicate and write every edge whose source lies in one chunk"""
+    model, index, lo, hi, num_nodes, num_edges, avg_degree, bounds, seed, work_dir, serialized_dir = task
+    rng = np.random.default_rng([seed, index])
+
+    if model == "rmat":
+        src, dst = _rmat_edges(rng, lo, hi, num_nodes, num_edges)
+    elif model == "powerlaw":
+        src, dst = _powerlaw_edges(rng, lo, hi, num_nodes, avg_degree)
+    else:
+        src, dst = _grid_edges(rng, lo, hi, num_nodes, avg_degree)
+
+    # Sources are confined to this chunk, so deduplicating here deduplicates globally
+    keys = np.unique(src[src != dst] * num_nodes + dst[src != dst])
+    src, dst = keys // num_nodes, keys % num_nodes
+
+    csv_path = os.path.join(work_dir, f"part_{index}.txt")
+    with open(csv_path, "w") as f:
+        for start in range(0, keys.size, 1 << 20):
+            np.savetxt(f, np.column_stack((src[start:start + (1 << 20)], dst[start:start + (1 << 20)])),
+                       fmt="%d\t%d")
+
+    if serialized_dir:
+        write_chunk(serialized_dir, "fwd", lo, hi, src, dst)
+
+        # Scatter reversed edges to the chunk owning their destination, for the bwd pass
+        owners = np.searchsorted([chunk_hi for _, chunk_hi in bounds], dst, side="right")
+        for owner in np.unique(owners):
+            mask = owners == owner
+            np.save(os.path.join(work_dir, f"bwd_{owner}_{index}.npy"), np.column_stack((dst[mask], src[mask])))
+
+    return keys.size
+
+
+def _assemble_bwd_chunk(task):
+    """Merge every reversed edge scattered to one chunk and write its bwd file"""
+    index, lo, hi, num_nodes, num_chunks, work_dir, serialized_dir = task
+    parts = [np.load(os.path.join(work_dir, f"bwd_{index}_{source}.npy"))
+             for source in range(num_chunks)
+             if os.path.exists(os.path.join(work_dir, f"bwd_{index}_{source}.npy"))]
+    edges = np.concatenate(parts) if parts else np.empty((0, 2), dtype=np.int64)
+    keys = np.sort(edges[:, 0] * num_nodes + edges[:, 1])
+    write_chunk(serialized_dir, "bwd", lo, hi, keys // num_nodes, keys % num_nodes)
+
+
+def generate_scalable_dataset(model="rmat", num_nodes=1 << 20, num_edges=1 << 24, workers=None, chunks=None,
+                              seed=0, output_file="data.txt", serialized_dir=None):
+    """
+    Generate a large synthetic graph in parallel:
+    - model is "rmat", "powerlaw" or "grid" (spatial building grid)
+    - nodes are split into ID-range chunks, each generated by one worker process
+      (for R-MAT, ranges are sized by expected edge count rather than ID count)
+    - writes the FromNodeId\tToNodeId text format to output_file and, if
+      serialized_dir is set, the engine's fwd/bwd chunk files next to it
+    """
+    workers = workers or os.cpu_count()
+    if model == "rmat":
+        num_nodes = 1 << max(1, (num_nodes - 1).bit_length())
+        # --chunks or the worker count only lower the per-chunk cap, so skewed chunks stay bounded
+        bounds = _rmat_chunk_bounds(num_nodes, num_edges,
+                                    min(MAX_EDGES_PER_CHUNK, math.ceil(num_edges / (chunks or workers))))
+    else:
+        bounds = chunk_bounds(num_nodes, chunks or max(workers, math.ceil(num_edges / MAX_EDGES_PER_CHUNK)))
+    chunks = len(bounds)
+    avg_degree = max(1, num_edges // num_nodes)
+    print(f"Generating {model} graph with {num_nodes} nodes and ~{num_edges} edges "
+          f"({chunks} chunks on {workers} workers)")
+
+    if serialized_dir:
+        os.makedirs(serialized_dir, exist_ok=True)
+    work_dir = tempfile.mkdtemp(prefix="generate_dataset_", dir=os.path.dirname(os.path.abspath(output_file)))
+    try:
+        with ProcessPoolExecutor(max_workers=workers) as pool:
+            tasks = [(model, i, lo, hi, num_nodes, num_edges, avg_degree, bounds, seed, work_dir, serialized_dir)
+                     for i, (lo, hi) in enumerate(bounds)]
+            total_edges = sum(pool.map(_generate_chunk, tasks))
+
+            if serialized_dir:
+                list(pool.map(_assemble_bwd_chunk,
+                              [(i, lo, hi, num_nodes, chunks, work_dir, serialized_dir)
+                               for i, (lo, hi) in enumerate(bounds)]))
+
+        # Chunks cover increasing source ranges, so concatenating them keeps the file sorted
+        with open(output_file, "w") as out:
+            out.write("# FromNodeId\tToNodeId\n")
+            for i in range(chunks):
+                with open(os.path.join(work_dir, f"part_{i}.txt")) as part:
+                    shutil.copyfileobj(part, out, 1 << 24)
+    finally:
+        shutil.rmtree(work_dir, ignore_errors=True)
+
+    print(f"Created graph with {num_nodes} nodes and {total_edges} edges in {output_file}")
+    if serialized_dir:
+        print(f"Serialized {2 * chunks} chunk files to {serialized_dir}")
+
+
 if __name__ == "__main__":
-    generate_graph_dataset()
\ No newline at end of file
+    parser = argparse.ArgumentParser(description="Generate a synthetic building connectivity dataset")
+    parser.add_argument("--model", choices=["legacy", "rmat", "powerlaw", "grid"], default="legacy",
+                        help="legacy reproduces the original 4K-node data.txt generator")
+    parser.add_argument("--nodes", type=int, default=1 << 20)
+    parser.add_argument("--edges", type=int, default=1 << 24)
+    parser.add_argument("--workers", type=int, default=None)
+    parser.add_argument("--chunks", type=int, default=None)
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--output", default="data.txt")
+    parser.add_argument("--serialized-dir", default=None,
+                        help="also write the engine's serialized fwd/bwd chunk files to this directory")
+    args = parser.parse_args()
+
+    if args.model == "legacy":
+        generate_graph_dataset(output_file=args.output)
+    else:
+        generate_scalable_dataset(args.model, args.nodes, args.edges, args.workers, args.chunks, args.seed,
+                                  args.output, args.serialized_dir)
\ No newline at end of file
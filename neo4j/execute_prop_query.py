@@ -1,11 +1,50 @@
+import argparse
+import sys
 from neo4j import GraphDatabase
 from neo4j_auth import URI, USERNAME, PASSWORD
 
+NUM_LEVELS = 4
+
+# Arrow of one hop for each propagation direction: forward follows the
+# dependency (what does this seed knock out), reverse walks it backwards
+# (which buildings could take this one down), and both treats connections as
+# symmetric, expanding incoming and outgoing relationships in the same hop
+HOP_PATTERNS = {
+    "forward": "-[:CONNECTED_TO]->",
+    "reverse": "<-[:CONNECTED_TO]-",
+    "both": "-[:CONNECTED_TO]-",
+}
+
+
+def build_level_query(level, direction):
+    """Cypher query returning every building exactly `level` hops away from the input set"""
+    hop = HOP_PATTERNS[direction]
+    path = "(n)" + "()".join([hop] * level) + "(neighbor:Building)"
+    return f"""
+        // Level {level} - {level} hop {direction} neighbors
+        MATCH (n:Building)
+        WHERE n.id IN $input_values
+        MATCH {path}
+        RETURN collect(DISTINCT neighbor.id) AS nodes
+        """
+
+
+def build_reach_query(max_hops):
+    """Cypher query for the shortest forward path of at most max_hops between two buildings"""
+    # shortestPath is expanded from both ends by Neo4j and stops on the first meet
+    return f"""
+        MATCH (a:Building {{id: $source}}), (b:Building {{id: $target}})
+        MATCH p = shortestPath((a)-[:CONNECTED_TO*..{int(max_hops)}]->(b))
+        RETURN length(p) AS hops
+        """
 
-def run_query_and_save_results():
-    results_file = open("Neo4J_results.txt", "w")
-    stats_file = open("Neo4J_stats.txt", "w")
 
+def run_query_and_save_results(direction="forward"):
+    """
+    Run every level query and save the results. A failed level exits non-zero
+    without writing an answer, so an outage is never reported as an empty
+    propagation.
+    """
     with open("../input_query.txt", "r") as f:
         input_text = f.read().strip()
 
@@ -13,47 +52,12 @@ def run_query_and_save_results():
     input_values = [int(x.strip()) for x in input_text.split(',') if x.strip()]
 
     all_levels = []
-    first_result_times = []
-    last_result_times = []
     total_times = []
 
     level0_nodes = input_values
     all_levels.append(sorted(level0_nodes))
-    results_file.write(str(sorted(level0_nodes)) + "\n")
-
-    queries = [
-        """
-        // Level 1 - One hop neighbors
-        MATCH (n:Building)
-        WHERE n.id IN $input_values
-        MATCH (n)-[:CONNECTED_TO]->(neighbor:Building)
-        RETURN collect(DISTINCT neighbor.id) AS nodes
-        """,
 
-        """
-        // Level 2 - Two hop neighbors
-        MATCH (n:Building)
-        WHERE n.id IN $input_values
-        MATCH (n)-[:CONNECTED_TO]->()-[:CONNECTED_TO]->(neighbor:Building)
-        RETURN collect(DISTINCT neighbor.id) AS nodes
-        """,
-
-        """
-        // Level 3 - Three hop neighbors
-        MATCH (n:Building)
-        WHERE n.id IN $input_values
-        MATCH (n)-[:CONNECTED_TO]->()-[:CONNECTED_TO]->()-[:CONNECTED_TO]->(neighbor:Building)
-        RETURN collect(DISTINCT neighbor.id) AS nodes
-        """,
-
-        """
-        // Level 4 - Four hop neighbors
-        MATCH (n:Building)
-        WHERE n.id IN $input_values
-        MATCH (n)-[:CONNECTED_TO]->()-[:CONNECTED_TO]->()-[:CONNECTED_TO]->()-[:CONNECTED_TO]->(neighbor:Building)
-        RETURN collect(DISTINCT neighbor.id) AS nodes
-        """
-    ]
+    queries = [build_level_query(level, direction) for level in range(1, NUM_LEVELS + 1)]
 
     for i, query in enumerate(queries):
         driver = GraphDatabase.driver(URI, auth=(USERNAME, PASSWORD))
@@ -79,9 +83,6 @@ def run_query_and_save_results():
 
             nodes = sorted(list(set(nodes)))
             all_levels.append(nodes)
-            results_file.write(str(nodes) + "\n")
-
-            stats_file.write(f"Query {i + 1} time (total execution time): {int(total_exec_time_us)} us\n")
 
             print(f"Query {i + 1} execution time:")
             print(f"{int(total_exec_time_us)} us")
@@ -92,17 +93,21 @@ def run_query_and_save_results():
                 pass
 
         except Exception as e:
-            print(f"Error executing query {i + 1}: {str(e)}")
-            stats_file.write(f"Query {i + 1} error: {str(e)}\n")
-            all_levels.append([])
-            results_file.write("[]\n")
-            first_result_times.append(0)
-            last_result_times.append(0)
-            total_times.append(0)
+            print(f"Error executing query {i + 1}: {str(e)}", file=sys.stderr)
+            sys.exit(1)
         finally:
             session.close()
             driver.close()
 
+    # Only written once every level has succeeded
+    results_file = open("Neo4J_results.txt", "w")
+    stats_file = open("Neo4J_stats.txt", "w")
+
+    for level in all_levels:
+        results_file.write(str(level) + "\n")
+    for i, total_exec_time_us in enumerate(total_times):
+        stats_file.write(f"Query {i + 1} time (total execution time): {int(total_exec_time_us)} us\n")
+
     stats_file.write("\nSUMMARY STATISTICS\n")
     stats_file.write("=================\n")
 
@@ -122,5 +127,65 @@ def run_query_and_save_results():
     print("Stats saved to Neo4J_stats.txt")
 
 
+def run_reach_query_and_save_results(source, target, max_hops):
+    """
+    Check whether a failure at source reaches target within max_hops and save
+    the results. A failed query exits non-zero without writing an answer, so it
+    is never reported as "not reachable".
+    """
+    hops = None
+    total_exec_time_us = 0
+    if source == target:
+        hops = 0
+    else:
+        driver = GraphDatabase.driver(URI, auth=(USERNAME, PASSWORD))
+        session = driver.session(database="neo4j")
+        try:
+            result = session.run(build_reach_query(max_hops), source=source, target=target)
+            record = result.single()
+            if record is not None:
+                hops = record["hops"]
+            total_exec_time_us = result.consume().result_consumed_after * 1000
+        except Exception as e:
+            print(f"Error executing reachability query: {str(e)}", file=sys.stderr)
+            sys.exit(1)
+        finally:
+            session.close()
+            driver.close()
+
+    results_file = open("Neo4J_results.txt", "w")
+    stats_file = open("Neo4J_stats.txt", "w")
+    results_file.write(f"[{source}, {target}]\n")
+    results_file.write(f"reachable within {max_hops} hops: {hops is not None}\n")
+    if hops is not None:
+        results_file.write(f"hops: {hops}\n")
+
+    stats_file.write(f"Query 1 time (total execution time): {int(total_exec_time_us)} us\n")
+    stats_file.write("\nSUMMARY STATISTICS\n")
+    stats_file.write("=================\n")
+    stats_file.write(f"Total Execution Time (all queries): {int(total_exec_time_us)} us\n")
+
+    results_file.close()
+    stats_file.close()
+
+    print(f"Building {target} {'is' if hops is not None else 'is not'} reachable from {source} within {max_hops} hops")
+    print("Results saved to Neo4J_results.txt")
+    print("Stats saved to Neo4J_stats.txt")
+
+
 if __name__ == "__main__":
-    run_query_and_save_results()
+    parser = argparse.ArgumentParser(description="Run a failure propagation query against Neo4j")
+    parser.add_argument("--direction", choices=sorted(HOP_PATTERNS), default="forward",
+                        help="forward: what the seeds knock out, reverse: what could knock the seeds out, "
+                             "both: either, treating connections as symmetric")
+    parser.add_argument("--reach", nargs=2, type=int, metavar=("SOURCE", "TARGET"),
+                        help="only check whether TARGET is reachable from SOURCE")
+    parser.add_argument("--max-hops", type=int, default=NUM_LEVELS)
+    args = parser.parse_args()
+    if args.max_hops < 1:
+        parser.error("--max-hops must be at least 1")
+
+    if args.reach:
+        run_reach_query_and_save_results(args.reach[0], args.reach[1], args.max_hops)
+    else:
+        run_query_and_save_results(args.direction)
@@ -1,6 +1,11 @@
+import os
+import sys
 from neo4j import GraphDatabase
 from neo4j_auth import URI, USERNAME, PASSWORD
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+from catalog_lookup import dataset_entry
+
 driver = GraphDatabase.driver(URI, auth=(USERNAME, PASSWORD))
 
 def create_constraints():
@@ -27,16 +32,30 @@ def create_constraints():
             print(f"⚠️ Warning with constraint: {str(e)}")
             print("⚠️ Proceeding with import anyway...")
 
-def import_building_data():
+def resolve_dataset_csv(name=None):
+    """
+    Look up the CSV path of a dataset in the catalog (the default dataset if
+    name is None). Only the default dataset can be loaded: the graph service
+    assumes Neo4j holds it, and would otherwise compare two different graphs.
+    """
+    name, entry, default = dataset_entry(name)
+    if name != default:
+        raise ValueError(f"Neo4j must hold the default dataset '{default}'; set \"default\" in datasets.json "
+                         f"to '{name}' and restart the service to switch")
+    if not os.path.isfile(entry["csv"]):
+        raise FileNotFoundError(f"Dataset CSV {entry['csv']} not found")
+    return entry["csv"]
+
+def import_building_data(csv_path):
     """Batch imports the building connectivity dataset into Neo4j."""
     with driver.session() as session:
         batch_size = 10000
         edges = []
         batch_num = 0
         
-        print("🔄 Starting building data import...")
+        print(f"🔄 Starting building data import from {csv_path}...")
         
-        with open('../data.txt', 'r') as f:
+        with open(csv_path, 'r') as f:
             for line in f:
                 if line.startswith('#'):  # Skip comments
                     continue
@@ -105,12 +124,14 @@ def count_data():
 if __name__ == "__main__":
     try:
         print("🚀 Starting building data import process...")
+        # Resolve the dataset before anything is cleared, so a bad name leaves the database untouched
+        csv_path = resolve_dataset_csv(sys.argv[1] if len(sys.argv) > 1 else None)
         # Clear database first
         clear_database()
         # Create constraints
         create_constraints()
         # Import data
-        import_building_data()
+        import_building_data(csv_path)
         # Show statistics
         count_data()
         print("✅ Import process completed successfully")
@@ -30,9 +30,12 @@ def process_results(result_data, source):
     """
     msg_type = result_data.get("type")
     content = result_data.get("content")
+    request = result_data.get("request")
 
     print(f"\n{'='*50}")
     print(f"📊 Received {source.upper()} {msg_type}:")
+    if request:
+        print(f"   for request {request.get('correlation_id')}: {request}")
     print(f"{'='*50}")
     print(content)
     print(f"{'='*50}\n")
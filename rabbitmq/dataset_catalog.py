@@ -0,0 +1,174 @@
+import json
+import os
+import shutil
+import threading
+
+# mydb2 resolves its inputs relative to its working directory, so every
+# published snapshot of a dataset gets a workspace with one session directory
+# per concurrent query slot, laid out the way the engine expects:
+#   <session>/data.txt          -> dataset CSV (edge list)
+#   <session>/amazon0601        -> serialized chunk directory
+#   <session>/input_query.txt   -> seed set of the session's current query
+#   <session>/run/              -> engine working directory and output files
+ENGINE_CSV_NAME = "data.txt"
+ENGINE_SERIALIZED_NAME = "amazon0601"
+ENGINE_INPUT_NAME = "input_query.txt"
+ENGINE_RUN_DIR = "run"
+
+# Snapshots published at runtime, kept in the workspace root so a refresh
+# survives a restart: {name: {"version": v, "csv": path, "serialized": path}}
+PUBLISHED_STATE_NAME = "published.json"
+
+
+class Snapshot:
+    """One published version of a dataset, pinned by the queries running on it"""
+
+    def __init__(self, dataset, version, paths, workspace_dir):
+        self.dataset = dataset
+        self.version = version
+        self.paths = paths
+        self.workspace_dir = workspace_dir
+        self.readers = 0
+        self.prepared_sessions = set()
+
+    def session_dir(self, session):
+        return os.path.join(self.workspace_dir, f"session_{session}")
+
+    def input_path(self, session):
+        return os.path.join(self.session_dir(session), ENGINE_INPUT_NAME)
+
+    def run_dir(self, session):
+        return os.path.join(self.session_dir(session), ENGINE_RUN_DIR)
+
+
+class DatasetCatalog:
+    """
+    Named datasets read from a JSON catalog. Queries pin the current snapshot
+    of a dataset with acquire()/release(); publish() swaps in a new snapshot
+    for later queries, and a retired snapshot's workspace is removed once its
+    last reader releases it. Published snapshots are recorded next to the
+    workspaces and take precedence over the JSON catalog on the next start.
+    """
+
+    def __init__(self, catalog_path, workspace_root):
+        with open(catalog_path, 'r') as f:
+            catalog = json.load(f)
+
+        self.base_dir = os.path.dirname(os.path.abspath(catalog_path))
+        self.workspace_root = os.path.abspath(workspace_root)
+        self.default = catalog["default"]
+        self._lock = threading.Lock()
+        self._current = {}
+        published = self._load_published()
+        for name, entry in {**catalog["datasets"], **published}.items():
+            self._current[name] = self._new_snapshot(name, entry.get("version", 0), entry)
+        self._remove_stale_workspaces()
+
+    def _new_snapshot(self, name, version, entry):
+        paths = {kind: os.path.join(self.base_dir, path) for kind, path in entry.items() if kind in ("csv", "serialized")}
+        return Snapshot(name, version, paths, os.path.join(self.workspace_root, name, f"v{version}"))
+
+    def _published_state_path(self):
+        return os.path.join(self.workspace_root, PUBLISHED_STATE_NAME)
+
+    def _load_published(self):
+        try:
+            with open(self._published_state_path(), 'r') as f:
+                return json.load(f)
+        except FileNotFoundError:
+            return {}
+
+    def _save_published(self, name, snapshot):
+        """Record a published snapshot; the file is replaced atomically so a crash leaves the old or new state"""
+        published = self._load_published()
+        published[name] = {"version": snapshot.version, **snapshot.paths}
+        os.makedirs(self.workspace_root, exist_ok=True)
+        temp_path = self._published_state_path() + ".tmp"
+        with open(temp_path, 'w') as f:
+            json.dump(published, f, indent=2)
+        os.replace(temp_path, self._published_state_path())
+
+    def _remove_stale_workspaces(self):
+        """Drop workspaces of versions a previous run retired, or left behind when it stopped"""
+        for name, snapshot in self._current.items():
+            dataset_dir = os.path.join(self.workspace_root, name)
+            if not os.path.isdir(dataset_dir):
+                continue
+            for version_dir in os.listdir(dataset_dir):
+                if version_dir != f"v{snapshot.version}":
+                    shutil.rmtree(os.path.join(dataset_dir, version_dir), ignore_errors=True)
+
+    def names(self):
+        return sorted(self._current)
+
+    def _prepare(self, snapshot, session):
+        """Create one session directory of a snapshot's workspace on first use"""
+        os.makedirs(snapshot.run_dir(session), exist_ok=True)
+        links = {ENGINE_CSV_NAME: snapshot.paths.get("csv"), ENGINE_SERIALIZED_NAME: snapshot.paths.get("serialized")}
+        for link_name, target in links.items():
+            link_path = os.path.join(snapshot.session_dir(session), link_name)
+            if os.path.lexists(link_path):
+                os.remove(link_path)
+            if target:
+                os.symlink(target, link_path)
+        snapshot.prepared_sessions.add(session)
+        print(f"📂 Prepared session {session} for dataset '{snapshot.dataset}' v{snapshot.version} "
+              f"at {snapshot.session_dir(session)}")
+
+    def acquire(self, name=None, session=0):
+        """
+        Pin the current snapshot of a dataset for the duration of one query.
+        Concurrent queries must use distinct session numbers so their input and
+        output files do not collide.
+        """
+        name = name or self.default
+        with self._lock:
+            if name not in self._current:
+                raise KeyError(f"Unknown dataset '{name}', known datasets: {', '.join(self.names())}")
+            snapshot = self._current[name]
+            if session not in snapshot.prepared_sessions:
+                self._prepare(snapshot, session)
+            snapshot.readers += 1
+            return snapshot
+
+    def release(self, snapshot):
+        """Unpin a snapshot, removing its workspace if it was retired and this was its last reader"""
+        with self._lock:
+            snapshot.readers -= 1
+            retire = snapshot.readers == 0 and self._current.get(snapshot.dataset) is not snapshot
+        if retire:
+            self._retire(snapshot)
+
+    def publish(self, name, entry):
+        """
+        Make a new snapshot ({"csv": ..., "serialized": ...}, relative to the
+        catalog) current for a dataset. A path missing from the entry is kept
+        from the previous snapshot. Queries already running keep their pinned
+        snapshot; the next acquire() sees the new one.
+        """
+        with self._lock:
+            previous = self._current.get(name)
+            if previous is not None:
+                entry = {**previous.paths, **entry}
+            missing_kinds = [kind for kind in ("csv", "serialized") if not entry.get(kind)]
+            if missing_kinds:
+                raise ValueError(f"New dataset '{name}' needs {' and '.join(missing_kinds)} paths")
+            snapshot = self._new_snapshot(name, previous.version + 1 if previous else 0, entry)
+            missing = [path for path in snapshot.paths.values() if not os.path.exists(path)]
+            if missing:
+                raise FileNotFoundError(f"Snapshot of '{name}' is missing {', '.join(missing)}")
+
+            # Build the first session before the swap so the first query on it pays nothing
+            self._prepare(snapshot, 0)
+            self._save_published(name, snapshot)
+            self._current[name] = snapshot
+            retire = previous is not None and previous.readers == 0
+        if retire:
+            self._retire(previous)
+        print(f"🔁 Published dataset '{name}' v{snapshot.version}")
+        return snapshot
+
+    def _retire(self, snapshot):
+        """Drop a snapshot's workspace; the dataset files it pointed at are left untouched"""
+        shutil.rmtree(snapshot.workspace_dir, ignore_errors=True)
+        print(f"🧹 Retired dataset '{snapshot.dataset}' v{snapshot.version}")
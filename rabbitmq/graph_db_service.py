@@ -4,7 +4,10 @@ import os
 import subprocess
 import time
 import re
-from threading import Thread
+from threading import Lock, Thread
+from service_metrics import MetricsRegistry
+from dataset_catalog import DatasetCatalog
+from query_scheduler import QueryScheduler, PRIORITY_INTERACTIVE, PRIORITY_BATCH
 
 # RabbitMQ configuration
 RABBITMQ_HOST = "localhost"
@@ -15,18 +18,21 @@ ROUTING_KEY_AFFECTED = "propagation.affected.buildings"  # Queue to listen to
 ROUTING_KEY_NEO4J_RESULTS = "propagation.neo4j.results"  # Queue to send Neo4j results to
 ROUTING_KEY_TACHOSDB_RESULTS = "propagation.tachosdb.results"  # Queue to send TachosDB results to
 ROUTING_KEY_PERFORMANCE_RATIO = "propagation.performance.ratio"  # New routing key for performance ratio
+ROUTING_KEY_DATASET_REFRESH = "propagation.dataset.refresh"  # Publish a new snapshot of a dataset
 QUEUE_NAME = "failure_propagation_queue"
 
 # File paths
-INPUT_QUERY_PATH = "../input_query.txt"
+DATASET_CATALOG_PATH = "../datasets.json"
+DATASET_WORKSPACE_ROOT = "dataset_workspaces"
 NEO4J_RESULTS_PATH = "Neo4J_results.txt"
 NEO4J_STATS_PATH = "Neo4J_stats.txt"
 TACHOSDB_RESULTS_PATH = "TachosDB_results.txt"
 TACHOSDB_STATS_PATH = "TachosDB_stats.txt"
+METRICS_PATH = "graph_db_service_metrics.prom"
 
 # Executable paths
-NEO4J_SCRIPT_PATH = "../neo4j/execute_prop_query.py"
-TACHOSDB_EXEC_PATH = "../cmake-build-release/mydb2"
+NEO4J_SCRIPT_PATH = os.path.abspath("../neo4j/execute_prop_query.py")
+TACHOSDB_EXEC_PATH = os.path.abspath("../cmake-build-release/mydb2")
 
 # Set up connection parameters
 credentials = pika.PlainCredentials(RABBITMQ_USER, RABBITMQ_PASSWORD)
@@ -37,32 +43,107 @@ parameters = pika.ConnectionParameters(
     blocked_connection_timeout=300
 )
 
-# Global flag to track processing state
-is_processing = False
+# Concurrency: queries run on worker threads, each in its own session directory
+MAX_CONCURRENT_QUERIES = 4
+MAX_PENDING_QUERIES = 64
+
+# Named datasets; TachosDB runs inside the workspace of the dataset a query targets
+catalog = DatasetCatalog(DATASET_CATALOG_PATH, DATASET_WORKSPACE_ROOT)
+
+# Latency and throughput metrics, exported to METRICS_PATH after every query
+metrics = MetricsRegistry()
+
+# Admission queue and worker pool, created once the connection is up (see main)
+scheduler = None
+
+# Queries running right now, by id. Concurrent engine runs compete for CPU and
+# the Neo4j script clears the shared query caches, so a query that overlapped
+# another one does not publish a performance ratio.
+running_queries = {}
+running_queries_lock = Lock()
+
+class ThreadSafeChannel:
+    """
+    Lets worker threads publish and acknowledge through the connection's own
+    thread. The calls run later as connection callbacks, so they log their own
+    outcome: an exception there would otherwise escape start_consuming and stop
+    the service.
+    """
+
+    def __init__(self, connection, channel):
+        self.connection = connection
+        self.channel = channel
+
+    def _defer(self, action, method, **kwargs):
+        def call():
+            try:
+                method(**kwargs)
+                print(f"✅ Done: {action}")
+            except Exception as e:
+                print(f"❌ Failed to {action}: {e}")
+        self.connection.add_callback_threadsafe(call)
+
+    def basic_publish(self, **kwargs):
+        self._defer(f"send message with routing key {kwargs['routing_key']}", self.channel.basic_publish, **kwargs)
+
+    def basic_ack(self, delivery_tag):
+        self._defer(f"acknowledge delivery {delivery_tag}", self.channel.basic_ack, delivery_tag=delivery_tag)
+
+class RequestChannel:
+    """
+    Channel of one query run. Several queries publish on the same routing keys
+    at once, so everything sent through it says which request it answers. A
+    query coalesced from several clicks answers each of them: every message is
+    published once per distinct correlation_id, carrying it both in the body's
+    "request" field and as the AMQP correlation_id.
+    """
+
+    def __init__(self, channel, query, attached):
+        self.channel = channel
+        self.attached = attached
+        self.request = {
+            "dataset": query["dataset"],
+            "direction": query["direction"],
+            "seeds": sorted(set(query["seeds"])),
+            "reach": query["reach"],
+            "hops": query["hops"],
+        }
+
+    def requests(self):
+        """(request field, AMQP properties) of every request this run answers"""
+        correlation_ids = list(dict.fromkeys(request["correlation_id"] for request in self.attached()))
+        return [({"correlation_id": correlation_id, **self.request},
+                 pika.BasicProperties(correlation_id=correlation_id) if correlation_id is not None else None)
+                for correlation_id in correlation_ids]
+
+    def basic_publish(self, **kwargs):
+        self.channel.basic_publish(**kwargs)
 
 def send_to_rabbitmq(channel, routing_key, message_type, content):
     """Send message to RabbitMQ"""
     try:
-        channel.basic_publish(
-            exchange=EXCHANGE_NAME,
-            routing_key=routing_key,
-            body=json.dumps({
-                "type": message_type,
-                "content": content
-            })
-        )
-        print(f"✅ Sent {message_type} to RabbitMQ with routing key {routing_key}")
+        message = {
+            "type": message_type,
+            "content": content
+        }
+        requests = channel.requests() if isinstance(channel, RequestChannel) else [(None, None)]
+        for request, properties in requests:
+            if request is not None:
+                message["request"] = request
+            channel.basic_publish(
+                exchange=EXCHANGE_NAME,
+                routing_key=routing_key,
+                body=json.dumps(message),
+                properties=properties
+            )
         return True
     except Exception as e:
         print(f"❌ Error sending {message_type}: {e}")
         return False
 
-def extract_total_execution_time(file_path):
-    """Extract the total execution time from a stats file"""
+def extract_total_execution_time(content):
+    """Extract the total execution time from the content of a stats file"""
     try:
-        with open(file_path, 'r') as f:
-            content = f.read()
-
         # Look for the total execution time line
         match = re.search(r'Total Execution Time \(all queries\): (\d+) us', content)
         if match:
@@ -76,18 +157,50 @@ def extract_total_execution_time(file_path):
 
         return total_time
     except Exception as e:
-        print(f"❌ Error extracting execution time from {file_path}: {e}")
+        print(f"❌ Error extracting execution time: {e}")
         return None
 
-def calculate_performance_ratio(channel):
-    """Calculate the ratio of Neo4j to TachosDB execution times and send to RabbitMQ"""
+def extract_level_stats(content):
+    """Extract per-level execution time (us) and peak memory (MB) from the content of a stats file"""
+    levels = {}
+
+    # TachosDB writes "Query N Execution Time: X us", Neo4j "Query N time (total execution time): X us"
+    for match in re.finditer(r'Query (\d+) (?:Execution Time|time \(total execution time\)): (\d+) us', content):
+        levels.setdefault(int(match.group(1)), {})["exec_us"] = int(match.group(2))
+    for match in re.finditer(r'Query (\d+) Peak Memory: ([\d.]+) MB', content):
+        levels.setdefault(int(match.group(1)), {})["peak_mb"] = float(match.group(2))
+
+    return levels
+
+def record_engine_metrics(engine, dataset, stats_content, wall_time_us):
+    """Record one engine run (process wall time and per-level stats) into the metrics registry"""
+    metrics.observe("propagation_engine_wall_time_us",
+                    "Wall time of one engine run including process startup",
+                    wall_time_us, {"engine": engine, "dataset": dataset})
+    for level, stats in extract_level_stats(stats_content).items():
+        labels = {"engine": engine, "dataset": dataset, "level": level}
+        if "exec_us" in stats:
+            metrics.observe("propagation_level_execution_time_us",
+                            "Execution time of one propagation level as reported by the engine",
+                            stats["exec_us"], labels)
+        if "peak_mb" in stats:
+            metrics.set("propagation_level_peak_memory_mb",
+                        "Peak memory reported by the engine after the last run of this level",
+                        stats["peak_mb"], labels)
+
+def export_metrics():
+    """Write the metrics registry to METRICS_PATH"""
     try:
-        # Wait for files to be completely written
-        time.sleep(2)
+        metrics.write(METRICS_PATH)
+    except Exception as e:
+        print(f"❌ Error writing metrics to {METRICS_PATH}: {e}")
 
-        # Extract execution times
-        neo4j_time = extract_total_execution_time(NEO4J_STATS_PATH)
-        tachosdb_time = extract_total_execution_time(TACHOSDB_STATS_PATH)
+def calculate_performance_ratio(channel, neo4j_stats, tachosdb_stats):
+    """Calculate the ratio of Neo4j to TachosDB execution times and send to RabbitMQ"""
+    try:
+        # Extract execution times from the stats already read for publishing
+        neo4j_time = extract_total_execution_time(neo4j_stats)
+        tachosdb_time = extract_total_execution_time(tachosdb_stats)
 
         if neo4j_time is None or tachosdb_time is None:
             print("❌ Failed to extract execution times")
@@ -116,14 +229,13 @@ def calculate_performance_ratio(channel):
         print(f"❌ Error calculating performance ratio: {e}")
         return False
 
-def process_neo4j_results(channel):
-    """Read and send Neo4j results and stats files"""
-    # Wait for files to be completely written
-    time.sleep(1)
+def process_neo4j_results(channel, run_dir):
+    """Read and send Neo4j results and stats files, returning the stats content (None if unreadable)"""
+    # The script has exited by now, so both files are complete
 
     # Process results file
     try:
-        with open(NEO4J_RESULTS_PATH, 'r') as f:
+        with open(os.path.join(run_dir, NEO4J_RESULTS_PATH), 'r') as f:
             results_content = f.read()
         send_to_rabbitmq(channel, ROUTING_KEY_NEO4J_RESULTS, "results", results_content)
     except Exception as e:
@@ -131,20 +243,21 @@ def process_neo4j_results(channel):
 
     # Process stats file
     try:
-        with open(NEO4J_STATS_PATH, 'r') as f:
+        with open(os.path.join(run_dir, NEO4J_STATS_PATH), 'r') as f:
             stats_content = f.read()
         send_to_rabbitmq(channel, ROUTING_KEY_NEO4J_RESULTS, "stats", stats_content)
+        return stats_content
     except Exception as e:
         print(f"❌ Error reading Neo4j stats file: {e}")
+        return None
 
-def process_tachosdb_results(channel):
-    """Read and send TachosDB results and stats files"""
-    # Wait for files to be completely written
-    time.sleep(1)
+def process_tachosdb_results(channel, run_dir):
+    """Read and send TachosDB results and stats files, returning the stats content (None if unreadable)"""
+    # The executable has exited by now, so both files are complete
 
     # Process results file
     try:
-        with open(TACHOSDB_RESULTS_PATH, 'r') as f:
+        with open(os.path.join(run_dir, TACHOSDB_RESULTS_PATH), 'r') as f:
             results_content = f.read()
         send_to_rabbitmq(channel, ROUTING_KEY_TACHOSDB_RESULTS, "results", results_content)
     except Exception as e:
@@ -152,108 +265,277 @@ def process_tachosdb_results(channel):
 
     # Process stats file
     try:
-        with open(TACHOSDB_STATS_PATH, 'r') as f:
+        with open(os.path.join(run_dir, TACHOSDB_STATS_PATH), 'r') as f:
             stats_content = f.read()
         send_to_rabbitmq(channel, ROUTING_KEY_TACHOSDB_RESULTS, "stats", stats_content)
+        return stats_content
     except Exception as e:
         print(f"❌ Error reading TachosDB stats file: {e}")
+        return None
+
+def clear_engine_outputs(run_dir, paths):
+    """
+    Remove an engine's output files from a session's run directory before it
+    runs, so a run that dies without writing them cannot publish the previous
+    query's results.
+    """
+    for path in paths:
+        try:
+            os.remove(os.path.join(run_dir, path))
+        except FileNotFoundError:
+            pass
 
-def run_neo4j_script(channel):
-    """Run the Neo4j script and process its output"""
+def run_neo4j_script(channel, run_dir, script_args=()):
+    """Run the Neo4j script in a session's run directory, returning its stats (None on failure)"""
     try:
         print("🚀 Running Neo4j script...")
+        clear_engine_outputs(run_dir, (NEO4J_RESULTS_PATH, NEO4J_STATS_PATH))
+        start_time = time.perf_counter()
         process = subprocess.Popen(
-            ["python", NEO4J_SCRIPT_PATH],
+            ["python", NEO4J_SCRIPT_PATH, *script_args],
+            cwd=run_dir,
             stdout=subprocess.PIPE,
             stderr=subprocess.PIPE
         )
         stdout, stderr = process.communicate()
+        wall_time_us = int((time.perf_counter() - start_time) * 1e6)
 
         print(f"📋 Neo4j script output: {stdout.decode()}")
 
-        if stderr:
-            print(f"⚠️ Neo4j script errors: {stderr.decode()}")
-            send_to_rabbitmq(channel, ROUTING_KEY_NEO4J_RESULTS, "error", stderr.decode())
-            return False
+        if stderr or process.returncode != 0:
+            error = stderr.decode() or f"Neo4j script exited with code {process.returncode}"
+            print(f"⚠️ Neo4j script errors: {error}")
+            send_to_rabbitmq(channel, ROUTING_KEY_NEO4J_RESULTS, "error", error)
+            return None
 
         # Process results
-        process_neo4j_results(channel)
-        return True
+        stats_content = process_neo4j_results(channel, run_dir)
+        if stats_content is not None:
+            record_engine_metrics("neo4j", catalog.default, stats_content, wall_time_us)
+        return stats_content
 
     except Exception as e:
         print(f"❌ Error running Neo4j script: {e}")
-        return False
+        return None
 
-def run_tachosdb_executable(channel):
-    """Run the TachosDB executable and process its output"""
+def run_tachosdb_executable(channel, snapshot, session):
+    """Run the TachosDB executable in a snapshot's session directory, returning its stats (None on failure)"""
     try:
-        print("🚀 Running TachosDB executable...")
+        print(f"🚀 Running TachosDB executable on dataset '{snapshot.dataset}' v{snapshot.version}...")
+        run_dir = snapshot.run_dir(session)
+        clear_engine_outputs(run_dir, (TACHOSDB_RESULTS_PATH, TACHOSDB_STATS_PATH))
+        start_time = time.perf_counter()
         process = subprocess.Popen(
             [TACHOSDB_EXEC_PATH],
+            cwd=run_dir,
             stdout=subprocess.PIPE,
             stderr=subprocess.PIPE
         )
         stdout, stderr = process.communicate()
+        wall_time_us = int((time.perf_counter() - start_time) * 1e6)
 
         print(f"📋 TachosDB executable output: {stdout.decode()}")
 
-        if stderr:
-            print(f"⚠️ TachosDB executable errors: {stderr.decode()}")
-            send_to_rabbitmq(channel, ROUTING_KEY_TACHOSDB_RESULTS, "error", stderr.decode())
-            return False
+        # A run killed for running out of memory leaves no stderr, only a signal exit code
+        if stderr or process.returncode != 0:
+            error = stderr.decode() or f"TachosDB exited with code {process.returncode}"
+            print(f"⚠️ TachosDB executable errors: {error}")
+            send_to_rabbitmq(channel, ROUTING_KEY_TACHOSDB_RESULTS, "error", error)
+            return None
 
         # Process results
-        process_tachosdb_results(channel)
-        return True
+        stats_content = process_tachosdb_results(channel, run_dir)
+        if stats_content is not None:
+            record_engine_metrics("tachosdb", snapshot.dataset, stats_content, wall_time_us)
+        return stats_content
 
     except Exception as e:
         print(f"❌ Error running TachosDB executable: {e}")
-        return False
-
-def process_message(channel, body):
-    """Process incoming messages and trigger scripts"""
-    global is_processing
+        return None
 
+def write_session_input(snapshot, session, seeds):
+    """Write a seed set where both engines read it: <session>/input_query.txt, i.e. ../ of the run directory"""
+    with open(snapshot.input_path(session), 'w') as f:
+        f.write(str(seeds))
+    print(f"📝 Wrote data to {snapshot.input_path(session)}")
+
+def run_propagation_query(channel, query, snapshot, session):
+    """Run a forward propagation on both engines and publish the performance ratio"""
+    dataset, seeds = query["dataset"], query["seeds"]
+    write_session_input(snapshot, session, seeds)
+
+    # Run the TachosDB executable first so its results are published as early as possible
+    tachosdb_stats = run_tachosdb_executable(channel, snapshot, session)
+
+    # Neo4j only holds the default dataset (see push_data_to_db.py)
+    run_neo4j = dataset == catalog.default
+    neo4j_stats = None
+    if run_neo4j:
+        neo4j_stats = run_neo4j_script(channel, snapshot.run_dir(session))
+    else:
+        print(f"ℹ️ Neo4j does not hold dataset '{dataset}', skipping Neo4j run")
+
+    # Calculate and send performance ratio, only when it compares the engines on an otherwise idle machine
+    if neo4j_stats is not None and tachosdb_stats is not None:
+        if query["overlapped"]:
+            print("ℹ️ Query ran alongside other queries, skipping performance ratio")
+        else:
+            calculate_performance_ratio(channel, neo4j_stats, tachosdb_stats)
+
+    neo4j_ok = neo4j_stats is not None or not run_neo4j
+    return "ok" if neo4j_ok and tachosdb_stats is not None else "error"
+
+def refresh_dataset(body):
+    """
+    Publish a new snapshot of a dataset: {"dataset": name, "csv": path, "serialized": path}.
+    The default dataset is refused: Neo4j keeps the graph it was loaded with, so
+    the performance ratio and the Neo4j-only queries would no longer run on the
+    same graph as TachosDB.
+    """
     try:
-        print(f"📩 Received message: {body.decode()}")
         data = json.loads(body.decode())
-
-        # Only process if not already running a query
-        if not is_processing:
-            is_processing = True
-
-            # Write the data to the input file
-            with open(INPUT_QUERY_PATH, 'w') as f:
-                f.write(str(data))
-            print(f"📝 Wrote data to {INPUT_QUERY_PATH}")
-
-            # Run the Neo4j script
-            neo4j_success = run_neo4j_script(channel)
-
-            # Run the TachosDB executable
-            tachosdb_success = run_tachosdb_executable(channel)
-
-            # Calculate and send performance ratio
-            if neo4j_success and tachosdb_success:
-                calculate_performance_ratio(channel)
-
-            # Reset processing flag
-            is_processing = False
-            print("🔄 Ready for next query")
-
-        else:
-            print("⏳ Already processing, skipping this message")
-
-    except json.JSONDecodeError:
-        print(f"❌ Invalid JSON in message: {body.decode()}")
-        is_processing = False
+        name = data.get("dataset")
+        if not name or name == catalog.default:
+            raise ValueError(f"The default dataset '{catalog.default}' is also loaded in Neo4j; reload Neo4j "
+                             "and restart the service to change it, or refresh a named dataset")
+        catalog.publish(name, {kind: data[kind] for kind in ("csv", "serialized") if data.get(kind)})
+        metrics.inc("dataset_refreshes_total", "Dataset snapshot refreshes, by outcome", {"status": "ok"})
     except Exception as e:
-        print(f"❌ Error processing message: {e}")
-        is_processing = False
+        print(f"❌ Error refreshing dataset: {e}")
+        metrics.inc("dataset_refreshes_total", "Dataset snapshot refreshes, by outcome", {"status": "error"})
+    export_metrics()
+
+def parse_query(data):
+    """
+    Turn a message into a query description. A bare list of building IDs is a
+    forward propagation on the default dataset. An object may name a
+    "dataset", ask for "direction": "reverse" ("which buildings could take
+    these down") or "both" (connections treated as symmetric), or ask
+    "reach": [source, target] with an optional "hops" bound ("can a failure at
+    source reach target"). Scenario scripts should set "priority": "batch" so
+    clicks from the UI are served first. Raises KeyError for a query that
+    cannot be answered, so it is rejected before admission.
+    """
+    if not isinstance(data, dict):
+        data = {"seeds": data}
+
+    query = {
+        "dataset": data.get("dataset") or catalog.default,
+        "seeds": data.get("seeds", []),
+        "direction": data.get("direction", "forward"),
+        "reach": data.get("reach"),
+        "hops": int(data.get("hops", 4)),
+        "priority": "batch" if data.get("priority") == "batch" else "interactive",
+        "received_at": time.perf_counter(),
+    }
+    if query["dataset"] not in catalog.names():
+        raise KeyError(f"Unknown dataset '{query['dataset']}', known datasets: {', '.join(catalog.names())}")
+    if query["direction"] not in ("forward", "reverse", "both"):
+        raise KeyError(f"Unknown direction '{query['direction']}'")
+    if query["reach"] is not None and len(query["reach"]) != 2:
+        raise KeyError("'reach' expects [source, target]")
+    if query["hops"] < 1:
+        raise ValueError("'hops' must be at least 1")
+    if (query["reach"] is not None or query["direction"] != "forward") and query["dataset"] != catalog.default:
+        # Only Neo4j answers these, and it only holds the default dataset
+        raise KeyError(f"Neo4j does not hold dataset '{query['dataset']}'")
+    return query
+
+def run_neo4j_only_query(channel, query, snapshot, session):
+    """Run a reverse, undirected or reachability query, which only the Neo4j side can answer"""
+    run_dir = snapshot.run_dir(session)
+    if query["reach"] is not None:
+        source, target = query["reach"]
+        stats = run_neo4j_script(channel, run_dir, ["--reach", str(int(source)), str(int(target)),
+                                                    "--max-hops", str(query["hops"])])
+    else:
+        write_session_input(snapshot, session, query["seeds"])
+        stats = run_neo4j_script(channel, run_dir, ["--direction", query["direction"]])
+    return "ok" if stats is not None else "error"
+
+def query_key(query):
+    """Identical queries share a key, so concurrent duplicates run once"""
+    reach = tuple(query["reach"]) if query["reach"] is not None else None
+    return (query["dataset"], query["direction"], reach, query["hops"], tuple(sorted(set(query["seeds"]))))
+
+def execute_query(channel, query, session, attached):
+    """
+    Run one admitted query on a worker thread; session is the worker's own
+    directory slot and attached() returns the requests it answers (see QueryScheduler)
+    """
+    channel = RequestChannel(channel, query, attached)
+    with running_queries_lock:
+        query["overlapped"] = bool(running_queries)
+        for other in running_queries.values():
+            other["overlapped"] = True
+        running_queries[id(query)] = query
+
+    # TachosDB only expands forward from a seed set
+    neo4j_only = query["reach"] is not None or query["direction"] != "forward"
+    try:
+        # Pin the dataset's current snapshot; a refresh published meanwhile only affects later queries
+        snapshot = catalog.acquire(query["dataset"], session)
+        try:
+            if neo4j_only:
+                status = run_neo4j_only_query(channel, query, snapshot, session)
+            else:
+                status = run_propagation_query(channel, query, snapshot, session)
+        finally:
+            catalog.release(snapshot)
+    except Exception as e:
+        # The message is acknowledged either way, so the client must hear about the failure
+        print(f"❌ Error running query: {e}")
+        send_to_rabbitmq(channel, ROUTING_KEY_NEO4J_RESULTS if neo4j_only else ROUTING_KEY_TACHOSDB_RESULTS,
+                         "error", str(e))
+        status = "error"
+    finally:
+        with running_queries_lock:
+            del running_queries[id(query)]
+
+    metrics.observe("propagation_query_latency_us", "Click-to-result latency of one propagation query",
+                    int((time.perf_counter() - query["received_at"]) * 1e6), {"priority": query["priority"]})
+    return status
+
+def complete_requests(channel, requests, status):
+    """Acknowledge every delivery served by one query run, now that its results are published"""
+    for request in requests:
+        channel.basic_ack(delivery_tag=request["delivery_tag"])
+    metrics.inc("propagation_queries_total", "Propagation queries processed, by outcome",
+                {"status": status}, amount=len(requests))
+    metrics.set("propagation_pending_queries", "Queries admitted but not yet started", scheduler.pending())
+    export_metrics()
+    print(f"🔄 Finished query for {len(requests)} request(s)")
+
+def process_message(channel, delivery_tag, body, correlation_id=None):
+    """Admit an incoming query; it is acknowledged once its results are published"""
+    try:
+        print(f"📩 Received message: {body.decode()}")
+        query = parse_query(json.loads(body.decode()))
+        priority = PRIORITY_BATCH if query["priority"] == "batch" else PRIORITY_INTERACTIVE
+        request = {"delivery_tag": delivery_tag, "correlation_id": correlation_id}
+        admission = scheduler.submit(query_key(query), priority, query, request)
+
+        if admission == "full":
+            # Hand the message back to the broker rather than dropping it
+            print("⏳ Admission queue full, requeueing message")
+            channel.basic_nack(delivery_tag=delivery_tag, requeue=True)
+        elif admission == "coalesced":
+            print("🔗 Identical query already in flight, attaching to it")
+        metrics.inc("propagation_admissions_total", "Query admission decisions", {"decision": admission})
+        metrics.set("propagation_pending_queries", "Queries admitted but not yet started", scheduler.pending())
+
+    except (json.JSONDecodeError, KeyError, TypeError, ValueError) as e:
+        print(f"❌ Invalid message {body.decode()}: {e}")
+        channel.basic_nack(delivery_tag=delivery_tag, requeue=False)
+        metrics.inc("propagation_queries_total", "Propagation queries processed, by outcome", {"status": "invalid"})
 
 def callback(ch, method, properties, body):
     """RabbitMQ message callback"""
-    process_message(ch, body)
+    if method.routing_key == ROUTING_KEY_DATASET_REFRESH:
+        refresh_dataset(body)
+        ch.basic_ack(delivery_tag=method.delivery_tag)
+    else:
+        process_message(ch, method.delivery_tag, body, properties.correlation_id)
 
 def setup_rabbitmq(channel):
     """Set up RabbitMQ exchange, queues, and bindings"""
@@ -270,6 +552,9 @@ def setup_rabbitmq(channel):
         channel.queue_bind(exchange=EXCHANGE_NAME, queue=QUEUE_NAME, routing_key=ROUTING_KEY_AFFECTED)
         print(f"✅ Queue '{QUEUE_NAME}' bound to exchange '{EXCHANGE_NAME}' with routing key '{ROUTING_KEY_AFFECTED}'")
 
+        channel.queue_bind(exchange=EXCHANGE_NAME, queue=QUEUE_NAME, routing_key=ROUTING_KEY_DATASET_REFRESH)
+        print(f"✅ Queue '{QUEUE_NAME}' bound to exchange '{EXCHANGE_NAME}' with routing key '{ROUTING_KEY_DATASET_REFRESH}'")
+
         # Declare result queues
         neo4j_queue = "neo4j_results_queue"
         tachosdb_queue = "tachosdb_results_queue"
@@ -301,10 +586,23 @@ def main():
         # Set up RabbitMQ with proper exchange and queues
         setup_rabbitmq(channel)
 
+        # Workers publish and ack through the connection thread
+        global scheduler
+        safe_channel = ThreadSafeChannel(connection, channel)
+        scheduler = QueryScheduler(
+            lambda query, session, attached: execute_query(safe_channel, query, session, attached),
+            lambda requests, status: complete_requests(safe_channel, requests, status),
+            MAX_CONCURRENT_QUERIES,
+            MAX_PENDING_QUERIES
+        )
+
+        # The broker keeps everything beyond what the scheduler can hold, which is our backpressure
+        channel.basic_qos(prefetch_count=MAX_CONCURRENT_QUERIES + MAX_PENDING_QUERIES)
+
         print(f"🔄 Waiting for '{ROUTING_KEY_AFFECTED}' messages... Press CTRL+C to exit.")
 
         # Start consuming
-        channel.basic_consume(queue=QUEUE_NAME, on_message_callback=callback, auto_ack=True)
+        channel.basic_consume(queue=QUEUE_NAME, on_message_callback=callback, auto_ack=False)
 
         try:
             channel.start_consuming()
@@ -0,0 +1,94 @@
+import heapq
+import itertools
+import threading
+
+# Lower value runs first: clicks from the UI go ahead of batch scenario runs
+PRIORITY_INTERACTIVE = 0
+PRIORITY_BATCH = 1
+
+
+class QueryScheduler:
+    """
+    Bounded admission queue in front of a fixed pool of worker threads.
+    Each worker owns one session number, so concurrent queries never share
+    input or output files. A query identical to one already pending or running
+    is coalesced with it, and every request attached to a query is reported to
+    on_done once it finishes.
+
+    run_query(query, session, attached) must call attached() before it
+    publishes anything: that closes the query to new requests and returns
+    every request it answers. A duplicate arriving later starts a fresh query
+    instead of being acknowledged with results it never received.
+    """
+
+    def __init__(self, run_query, on_done, num_workers, max_pending):
+        self._run_query = run_query
+        self._on_done = on_done
+        self._max_pending = max_pending
+        self._heap = []
+        self._in_flight = {}  # Query key -> requests waiting on that query
+        self._sequence = itertools.count()
+        self._condition = threading.Condition()
+        self._workers = [threading.Thread(target=self._work, args=(session,), daemon=True)
+                         for session in range(num_workers)]
+        for worker in self._workers:
+            worker.start()
+
+    def submit(self, key, priority, query, request):
+        """
+        Admit a request. Returns "coalesced" if it joined an identical query,
+        "queued" if it was enqueued, or "full" if the queue is at capacity and
+        the caller must hand the request back (e.g. requeue it on the broker).
+        """
+        with self._condition:
+            if key in self._in_flight:
+                self._in_flight[key].append(request)
+                self._raise_priority(key, priority)
+                return "coalesced"
+            if len(self._heap) >= self._max_pending:
+                return "full"
+
+            self._in_flight[key] = [request]
+            heapq.heappush(self._heap, (priority, next(self._sequence), key, query))
+            self._condition.notify()
+            return "queued"
+
+    def _raise_priority(self, key, priority):
+        """A click joining a pending batch query must not wait behind other batch queries"""
+        for i, (pending_priority, sequence, pending_key, query) in enumerate(self._heap):
+            if pending_key == key:
+                if priority < pending_priority:
+                    self._heap[i] = (priority, sequence, key, query)
+                    heapq.heapify(self._heap)
+                return
+
+    def pending(self):
+        with self._condition:
+            return len(self._heap)
+
+    def _work(self, session):
+        while True:
+            with self._condition:
+                while not self._heap:
+                    self._condition.wait()
+                _, _, key, query = heapq.heappop(self._heap)
+
+            attached = self._attacher(key)
+            try:
+                status = self._run_query(query, session, attached)
+            except Exception as e:
+                print(f"❌ Error running query: {e}")
+                status = "error"
+            self._on_done(attached(), status)
+
+    def _attacher(self, key):
+        """Callable closing a query to new requests on its first call, returning its requests on every call"""
+        closed = []
+
+        def attached():
+            with self._condition:
+                if not closed:
+                    # New identical requests start a fresh query from here on
+                    closed.append(self._in_flight.pop(key))
+                return closed[0]
+        return attached
@@ -0,0 +1,103 @@
+import bisect
+import os
+import threading
+
+# Latency buckets in microseconds: 1-2-5 steps per decade from 1 us to 100 s,
+# fine enough to read p50/p95/p99 off the exported histograms
+LATENCY_BUCKETS_US = [m * 10 ** e for e in range(0, 8) for m in (1, 2, 5)] + [10 ** 8]
+
+
+def _format_labels(labels):
+    """Render a label dict as a Prometheus label set"""
+    if not labels:
+        return ""
+    pairs = ",".join(f'{key}="{value}"' for key, value in sorted(labels.items()))
+    return "{" + pairs + "}"
+
+
+class Histogram:
+    """Cumulative bucket histogram, rendered in Prometheus text format"""
+
+    def __init__(self, buckets=LATENCY_BUCKETS_US):
+        self.buckets = list(buckets)
+        self.counts = [0] * (len(self.buckets) + 1)  # Last slot is +Inf
+        self.total = 0
+        self.count = 0
+
+    def observe(self, value):
+        self.counts[bisect.bisect_left(self.buckets, value)] += 1
+        self.total += value
+        self.count += 1
+
+    def render(self, name, labels):
+        lines = []
+        cumulative = 0
+        for bound, bucket_count in zip(self.buckets, self.counts):
+            cumulative += bucket_count
+            lines.append(f"{name}_bucket{_format_labels({**labels, 'le': bound})} {cumulative}")
+        lines.append(f"{name}_bucket{_format_labels({**labels, 'le': '+Inf'})} {self.count}")
+        lines.append(f"{name}_sum{_format_labels(labels)} {self.total}")
+        lines.append(f"{name}_count{_format_labels(labels)} {self.count}")
+        return lines
+
+
+class MetricsRegistry:
+    """Counters, gauges and histograms shared by the service's handlers"""
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._write_lock = threading.Lock()
+        self._help = {}
+        self._types = {}
+        self._samples = {}
+
+    def _declare(self, name, metric_type, help_text):
+        if name not in self._types:
+            self._types[name] = metric_type
+            self._help[name] = help_text
+            self._samples[name] = {}
+
+    def inc(self, name, help_text, labels=None, amount=1):
+        labels = labels or {}
+        with self._lock:
+            self._declare(name, "counter", help_text)
+            key = tuple(sorted(labels.items()))
+            self._samples[name][key] = self._samples[name].get(key, 0) + amount
+
+    def set(self, name, help_text, value, labels=None):
+        labels = labels or {}
+        with self._lock:
+            self._declare(name, "gauge", help_text)
+            self._samples[name][tuple(sorted(labels.items()))] = value
+
+    def observe(self, name, help_text, value, labels=None):
+        labels = labels or {}
+        with self._lock:
+            self._declare(name, "histogram", help_text)
+            key = tuple(sorted(labels.items()))
+            if key not in self._samples[name]:
+                self._samples[name][key] = Histogram()
+            self._samples[name][key].observe(value)
+
+    def render(self):
+        """Render every metric in the Prometheus text exposition format"""
+        lines = []
+        with self._lock:
+            for name in sorted(self._types):
+                lines.append(f"# HELP {name} {self._help[name]}")
+                lines.append(f"# TYPE {name} {self._types[name]}")
+                for key, sample in sorted(self._samples[name].items()):
+                    labels = dict(key)
+                    if isinstance(sample, Histogram):
+                        lines.extend(sample.render(name, labels))
+                    else:
+                        lines.append(f"{name}{_format_labels(labels)} {sample}")
+        return "\n".join(lines) + "\n"
+
+    def write(self, path):
+        """Atomically replace the metrics file so scrapers never see a partial write"""
+        tmp_path = f"{path}.tmp"
+        with self._write_lock:
+            with open(tmp_path, "w") as f:
+                f.write(self.render())
+            os.replace(tmp_path, path)
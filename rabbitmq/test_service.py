@@ -0,0 +1,256 @@
+import json
+import os
+import queue
+import shutil
+import sys
+import tempfile
+import time
+import types
+
+# Exercises graph_db_service.py without RabbitMQ, Neo4j or mydb2: a stand-in
+# broker replays the connection thread, and stub engines echo the seed set.
+# Run from this directory: python test_service.py
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TIMEOUT_S = 10
+
+# Only the pieces of pika the service touches
+class BasicProperties:
+    def __init__(self, correlation_id=None):
+        self.correlation_id = correlation_id
+
+sys.modules["pika"] = types.SimpleNamespace(
+    PlainCredentials=lambda *args: None,
+    ConnectionParameters=lambda **kwargs: None,
+    BasicProperties=BasicProperties,
+    exceptions=types.SimpleNamespace(AMQPConnectionError=ConnectionError),
+)
+
+os.chdir(HERE)
+sys.path.insert(0, HERE)
+import graph_db_service as service
+from dataset_catalog import DatasetCatalog
+from query_scheduler import QueryScheduler
+
+# TachosDB stand-in: echoes the seeds; seed 999 holds a worker for a while so others queue up behind it
+TACHOSDB_STUB = """#!/bin/sh
+grep -q 999 ../input_query.txt && sleep 0.5
+cat ../input_query.txt > TachosDB_results.txt
+printf 'Query 1 Execution Time: 3 us\\nTotal Execution Time (all queries): 3 us\\n' > TachosDB_stats.txt
+"""
+NEO4J_STUB = """import sys
+open("Neo4J_results.txt", "w").write(open("../input_query.txt").read() if "--reach" not in sys.argv else str(sys.argv))
+open("Neo4J_stats.txt", "w").write("Query 1 time (total execution time): 9 us\\nTotal Execution Time (all queries): 9 us\\n")
+"""
+DEAD_ENGINE_STUB = """#!/bin/sh
+kill -9 $$
+"""
+
+
+class Broker:
+    """Stand-in for the channel and connection: deferred calls run on the main thread, like pika's connection thread"""
+
+    def __init__(self):
+        self.callbacks = queue.Queue()
+        self.published = []  # (routing key, message, AMQP correlation_id)
+        self.acks = []
+        self.nacks = []
+
+    def add_callback_threadsafe(self, callback):
+        self.callbacks.put(callback)
+
+    def basic_publish(self, exchange, routing_key, body, properties=None):
+        self.published.append((routing_key, json.loads(body), properties.correlation_id if properties else None))
+
+    def basic_ack(self, delivery_tag):
+        self.acks.append(delivery_tag)
+
+    def basic_nack(self, delivery_tag, requeue):
+        self.nacks.append((delivery_tag, requeue))
+
+    def pump_until(self, done):
+        deadline = time.monotonic() + TIMEOUT_S
+        while not done():
+            if time.monotonic() > deadline:
+                raise TimeoutError("service did not finish in time")
+            try:
+                self.callbacks.get(timeout=0.05)()
+            except queue.Empty:
+                pass
+
+    def deliver(self, delivery_tag, message, correlation_id=None):
+        service.process_message(self, delivery_tag, json.dumps(message).encode(), correlation_id)
+
+    def settled(self, count):
+        return lambda: len(self.acks) + len(self.nacks) >= count
+
+    def seeds_run(self, routing_key=service.ROUTING_KEY_TACHOSDB_RESULTS):
+        """Seed sets of the results published on one routing key, in publishing order, once per run"""
+        runs = []
+        for key, message, _ in self.published:
+            if key == routing_key and message["type"] == "results" and message["request"]["seeds"] not in runs:
+                runs.append(message["request"]["seeds"])
+        return runs
+
+
+def start_service(workers, max_pending=8):
+    """Fresh broker and scheduler on the stub engines"""
+    broker = Broker()
+    channel = service.ThreadSafeChannel(broker, broker)
+    service.scheduler = QueryScheduler(
+        lambda query, session, attached: service.execute_query(channel, query, session, attached),
+        lambda requests, status: service.complete_requests(channel, requests, status),
+        workers,
+        max_pending
+    )
+    return broker
+
+
+def wait_until_started(broker):
+    broker.pump_until(lambda: service.scheduler.pending() == 0)
+    time.sleep(0.1)
+
+
+def check_ack_and_nack():
+    broker = start_service(workers=2)
+    broker.deliver(0, [1, 2], "a")
+    broker.deliver(1, {"dataset": "nope", "seeds": [1]}, "b")
+    broker.deliver(2, {"direction": "reverse", "seeds": [3]}, "c")
+    broker.deliver(3, {"reach": [1], "hops": 2}, "d")
+    broker.pump_until(broker.settled(4))
+    assert sorted(broker.acks) == [0, 2], broker.acks
+    assert sorted(broker.nacks) == [(1, False), (3, False)], broker.nacks
+    assert all(message["type"] != "error" for _, message, _ in broker.published)
+
+
+def check_full_queue_requeues():
+    broker = start_service(workers=1, max_pending=1)
+    broker.deliver(0, [999])
+    wait_until_started(broker)
+    broker.deliver(1, [1])
+    broker.deliver(2, [2])
+    broker.pump_until(broker.settled(3))
+    assert broker.nacks == [(2, True)], broker.nacks
+    assert sorted(broker.acks) == [0, 1], broker.acks
+
+
+def check_coalesced_requests_are_all_answered():
+    broker = start_service(workers=1)
+    broker.deliver(0, [999], "blocker")
+    wait_until_started(broker)
+    broker.deliver(1, [1, 2], "c2")
+    broker.deliver(2, [2, 1], "c3")
+    broker.pump_until(broker.settled(3))
+    assert broker.seeds_run() == [[999], [1, 2]], broker.seeds_run()
+    answers = {correlation_id: [(key, message["type"]) for key, message, amqp_id in broker.published
+                                if message["request"]["correlation_id"] == correlation_id == amqp_id]
+               for correlation_id in ("c2", "c3")}
+    assert answers["c2"] == answers["c3"], answers
+    assert sum(message_type in ("results", "stats") for _, message_type in answers["c3"]) == 4, answers
+
+
+def check_duplicate_after_publishing_runs_again():
+    broker = start_service(workers=2)
+    run_neo4j_script = service.run_neo4j_script
+
+    def deliver_duplicate_first(channel, run_dir, script_args=()):
+        # TachosDB has published by now, so the query is closed to new requests
+        service.run_neo4j_script = run_neo4j_script
+        broker.add_callback_threadsafe(lambda: broker.deliver(1, [5], "late"))
+        return run_neo4j_script(channel, run_dir, script_args)
+
+    service.run_neo4j_script = deliver_duplicate_first
+    try:
+        broker.deliver(0, [5], "early")
+        broker.pump_until(broker.settled(2))
+    finally:
+        service.run_neo4j_script = run_neo4j_script
+    late = [message["type"] for _, message, _ in broker.published if message["request"]["correlation_id"] == "late"]
+    assert sorted(late) == ["results", "results", "stats", "stats"], late
+
+
+def check_interactive_overtakes_batch():
+    broker = start_service(workers=1)
+    broker.deliver(0, [999])
+    wait_until_started(broker)
+    broker.deliver(1, {"seeds": [11], "priority": "batch"})
+    broker.deliver(2, {"seeds": [12], "priority": "batch"})
+    broker.deliver(3, [13])
+    broker.pump_until(broker.settled(4))
+    assert broker.seeds_run() == [[999], [13], [11], [12]], broker.seeds_run()
+
+
+def check_click_raises_coalesced_batch_query():
+    broker = start_service(workers=1)
+    broker.deliver(0, [999])
+    wait_until_started(broker)
+    broker.deliver(1, {"seeds": [11], "priority": "batch"})
+    broker.deliver(2, {"seeds": [12], "priority": "batch"})
+    broker.deliver(3, [12])
+    broker.pump_until(broker.settled(4))
+    assert broker.seeds_run() == [[999], [12], [11]], broker.seeds_run()
+
+
+def check_dead_engine_publishes_error():
+    broker = start_service(workers=1)
+    service.TACHOSDB_EXEC_PATH = DEAD_ENGINE_PATH
+    try:
+        broker.deliver(0, [1], "dead")
+        broker.pump_until(broker.settled(1))
+    finally:
+        service.TACHOSDB_EXEC_PATH = TACHOSDB_PATH
+    tachosdb = [message["type"] for key, message, _ in broker.published if key == service.ROUTING_KEY_TACHOSDB_RESULTS]
+    assert tachosdb == ["error"], tachosdb
+    assert broker.acks == [0], broker.acks
+
+
+def forbidden_sleep(seconds):
+    raise AssertionError(f"service slept {seconds} s")
+
+
+def check_no_sleep_handoff():
+    # Results are read once the engine process has exited; nothing in the service may wait on a timer
+    broker = start_service(workers=1)
+    service.time = types.SimpleNamespace(time=time.time, perf_counter=time.perf_counter, sleep=forbidden_sleep)
+    try:
+        broker.deliver(0, [1, 2], "a")
+        broker.pump_until(broker.settled(1))
+    finally:
+        service.time = time
+    results = [message["content"] for key, message, _ in broker.published if message["type"] == "results"]
+    assert results == ["[1, 2]", "[1, 2]"], results
+
+
+def write_stub(directory, name, content):
+    path = os.path.join(directory, name)
+    with open(path, 'w') as f:
+        f.write(content)
+    os.chmod(path, 0o755)
+    return path
+
+
+if __name__ == "__main__":
+    work_dir = tempfile.mkdtemp(prefix="graph_db_service_test_")
+    try:
+        TACHOSDB_PATH = write_stub(work_dir, "mydb2", TACHOSDB_STUB)
+        DEAD_ENGINE_PATH = write_stub(work_dir, "dead_mydb2", DEAD_ENGINE_STUB)
+        service.TACHOSDB_EXEC_PATH = TACHOSDB_PATH
+        service.NEO4J_SCRIPT_PATH = write_stub(work_dir, "execute_prop_query.py", NEO4J_STUB)
+        service.METRICS_PATH = os.path.join(work_dir, "metrics.prom")
+        service.catalog = DatasetCatalog(service.DATASET_CATALOG_PATH, os.path.join(work_dir, "workspaces"))
+
+        checks = [check_ack_and_nack, check_full_queue_requeues, check_coalesced_requests_are_all_answered,
+                  check_duplicate_after_publishing_runs_again, check_interactive_overtakes_batch,
+                  check_click_raises_coalesced_batch_query, check_dead_engine_publishes_error,
+                  check_no_sleep_handoff]
+        failed = 0
+        for check in checks:
+            try:
+                check()
+                print(f"✅ {check.__name__}")
+            except Exception as e:
+                failed += 1
+                print(f"❌ {check.__name__}: {e!r}")
+    finally:
+        shutil.rmtree(work_dir, ignore_errors=True)
+    sys.exit(1 if failed else 0)
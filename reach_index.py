@@ -0,0 +1,166 @@
+import argparse
+import os
+import shutil
+import tempfile
+from concurrent.futures import ProcessPoolExecutor
+import numpy as np
+from catalog_lookup import resolve_dataset
+from serialized_dataset import find_chunks, read_chunk
+
+# HyperLogLog registers per node; 64 registers give ~13% relative error per estimate
+DEFAULT_REGISTERS = 64
+
+
+def index_path(serialized_dir, num_nodes, hops):
+    """The reach index is stored next to the dataset's serialized chunks"""
+    return os.path.join(serialized_dir, f"reach_{num_nodes}_k{hops}.npy")
+
+
+def _splitmix64(x):
+    """Vectorised splitmix64 finaliser, used as the per-node HyperLogLog hash"""
+    with np.errstate(over="ignore"):
+        x = x.astype(np.uint64) + np.uint64(0x9E3779B97F4A7C15)
+        x = (x ^ (x >> np.uint64(30))) * np.uint64(0xBF58476D1CE4E5B9)
+        x = (x ^ (x >> np.uint64(27))) * np.uint64(0x94D049BB133111EB)
+        return x ^ (x >> np.uint64(31))
+
+
+def _bit_length(x):
+    """Exact vectorised bit length of uint64 values"""
+    length = np.zeros(x.shape, dtype=np.int64)
+    for shift in (32, 16, 8, 4, 2, 1):
+        high = x >= (np.uint64(1) << np.uint64(shift))
+        length += high * shift
+        x = np.where(high, x >> np.uint64(shift), x)
+    return length + (x > 0)
+
+
+def initial_registers(lo, hi, num_registers):
+    """Registers of the hop-0 sketches, each holding only the node itself"""
+    index_bits = num_registers.bit_length() - 1
+    hashes = _splitmix64(np.arange(lo, hi, dtype=np.uint64))
+    registers = np.zeros((hi - lo, num_registers), dtype=np.uint8)
+    remaining = hashes >> np.uint64(index_bits)
+    rank = (64 - index_bits) - _bit_length(remaining) + 1
+    registers[np.arange(hi - lo), (hashes & np.uint64(num_registers - 1)).astype(np.int64)] = rank
+    return registers
+
+
+def estimate(registers):
+    """HyperLogLog cardinality estimate of every row, with the small-range correction"""
+    num_registers = registers.shape[1]
+    # Bias correction constant; the closed form only holds from 128 registers on
+    alpha = {16: 0.673, 32: 0.697, 64: 0.709}.get(num_registers, 0.7213 / (1 + 1.079 / num_registers))
+    raw = alpha * num_registers ** 2 / np.exp2(-registers.astype(np.float64)).sum(axis=1)
+    zeros = (registers == 0).sum(axis=1)
+    with np.errstate(divide="ignore"):
+        linear = num_registers * np.log(num_registers / np.maximum(zeros, 1))
+    return np.where((raw <= 2.5 * num_registers) & (zeros > 0), linear, raw)
+
+
+def _propagate_chunk(task):
+    """
+    One HyperANF step for one chunk: a node's new sketch is the register-wise
+    max of its own sketch and those of its out-neighbours, merged with
+    maximum.reduceat over the neighbour rows.
+    """
+    previous_path, next_path, lo, hi, chunk_path = task
+    previous = np.load(previous_path, mmap_mode="r")
+    counts, neighbours = read_chunk(chunk_path, lo, hi)
+
+    merged = np.array(previous[lo:hi])
+    has_neighbours = np.flatnonzero(counts)
+    if has_neighbours.size:
+        starts = np.concatenate(([0], np.cumsum(counts)[:-1]))[has_neighbours]
+        neighbour_max = np.maximum.reduceat(previous[neighbours], starts, axis=0)
+        merged[has_neighbours] = np.maximum(merged[has_neighbours], neighbour_max)
+
+    out = np.load(next_path, mmap_mode="r+")
+    out[lo:hi] = merged
+    out.flush()
+    return estimate(merged).astype(np.float32)
+
+
+def build_reach_index(serialized_dir, num_nodes, hops=4, num_registers=DEFAULT_REGISTERS, workers=None):
+    """
+    Estimate, for every node and every hop t <= hops, how many nodes lie within
+    t forward hops of it (HyperANF), and persist the (num_nodes, hops + 1)
+    float32 table next to the serialized dataset.
+    """
+    chunks = find_chunks(serialized_dir, "fwd", num_nodes)
+    work_dir = tempfile.mkdtemp(prefix="reach_index_", dir=serialized_dir)
+    reach = np.ones((num_nodes, hops + 1), dtype=np.float32)
+
+    try:
+        previous_path = os.path.join(work_dir, "registers_0.npy")
+        registers = np.lib.format.open_memmap(previous_path, mode="w+", dtype=np.uint8,
+                                              shape=(num_nodes, num_registers))
+        for lo, hi, _ in chunks:
+            registers[lo:hi] = initial_registers(lo, hi, num_registers)
+        registers.flush()
+        del registers
+
+        with ProcessPoolExecutor(max_workers=workers or os.cpu_count()) as pool:
+            for hop in range(1, hops + 1):
+                next_path = os.path.join(work_dir, f"registers_{hop}.npy")
+                np.lib.format.open_memmap(next_path, mode="w+", dtype=np.uint8, shape=(num_nodes, num_registers))
+
+                tasks = [(previous_path, next_path, lo, hi, path) for lo, hi, path in chunks]
+                for (lo, hi, _), estimates in zip(chunks, pool.map(_propagate_chunk, tasks)):
+                    reach[lo:hi, hop] = estimates
+
+                os.remove(previous_path)
+                previous_path = next_path
+                print(f"Hop {hop}: mean estimated reach {reach[:, hop].mean():.1f}")
+    finally:
+        shutil.rmtree(work_dir, ignore_errors=True)
+
+    path = index_path(serialized_dir, num_nodes, hops)
+    np.save(path, reach)
+    print(f"Saved reach index for {num_nodes} nodes and {hops} hops to {path}")
+    return path
+
+
+def load_reach_index(serialized_dir, num_nodes, hops=4):
+    """Memory-map a persisted reach index; rows are nodes, columns are hops"""
+    return np.load(index_path(serialized_dir, num_nodes, hops), mmap_mode="r")
+
+
+def most_dangerous(reach, hop, count):
+    """The `count` nodes with the largest estimated reach within `hop` hops, largest first"""
+    count = min(count, reach.shape[0])
+    candidates = np.argpartition(-reach[:, hop], count - 1)[:count]
+    return candidates[np.argsort(-reach[candidates, hop], kind="stable")]
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Approximate k-hop blast radius index (HyperANF)")
+    parser.add_argument("--dataset", default=None, help="catalog dataset name (default dataset if omitted)")
+    parser.add_argument("--hops", type=int, default=4)
+    subparsers = parser.add_subparsers(dest="command", required=True)
+
+    build = subparsers.add_parser("build", help="compute and persist the index")
+    build.add_argument("--registers", type=int, default=DEFAULT_REGISTERS, help="power of two")
+    build.add_argument("--workers", type=int, default=None)
+
+    lookup = subparsers.add_parser("lookup", help="estimated reach of one building for every hop")
+    lookup.add_argument("node", type=int)
+
+    top = subparsers.add_parser("top", help="buildings with the largest estimated reach")
+    top.add_argument("count", type=int)
+    top.add_argument("--hop", type=int, default=None, help="defaults to --hops")
+
+    args = parser.parse_args()
+    serialized_dir, num_nodes = resolve_dataset(args.dataset)
+
+    if args.command == "build":
+        build_reach_index(serialized_dir, num_nodes, args.hops, args.registers, args.workers)
+    elif args.command == "lookup":
+        reach = load_reach_index(serialized_dir, num_nodes, args.hops)
+        for hop, value in enumerate(reach[args.node]):
+            print(f"Building {args.node} - hop {hop}: ~{value:.0f} buildings")
+    else:
+        reach = load_reach_index(serialized_dir, num_nodes, args.hops)
+        hop = args.hops if args.hop is None else args.hop
+        for rank, node in enumerate(most_dangerous(reach, hop, args.count), start=1):
+            print(f"{rank}. Building {node}: ~{reach[node, hop]:.0f} buildings within {hop} hops")
@@ -0,0 +1,99 @@
+import os
+import numpy as np
+
+# On-disk layout of a serialized TachosDB dataset: one file per direction and
+# node-ID range, named "<fwd|bwd>_<lo>_<hi>.bin". For every node in [lo, hi) the
+# file holds a little-endian uint64 neighbour count followed by that many
+# sorted uint64 neighbour IDs.
+# Optional per-edge propagation delays of a forward chunk live next to it in
+# "delay_fwd_<lo>_<hi>.bin": one little-endian float32 (seconds) per neighbour,
+# in the same order as the chunk's neighbour IDs.
+DIRECTIONS = ("fwd", "bwd")
+
+
+def chunk_bounds(num_nodes, num_chunks):
+    """Split [0, num_nodes) into num_chunks contiguous ranges, like the serializer does"""
+    base, extra = divmod(num_nodes, num_chunks)
+    bounds = []
+    lo = 0
+    for i in range(num_chunks):
+        hi = lo + base + (1 if i < extra else 0)
+        bounds.append((lo, hi))
+        lo = hi
+    return bounds
+
+
+def chunk_file_name(direction, lo, hi):
+    return f"{direction}_{lo}_{hi}.bin"
+
+
+def delay_file_name(lo, hi):
+    return f"delay_fwd_{lo}_{hi}.bin"
+
+
+def encode_chunk(lo, hi, nodes, neighbours):
+    """
+    Encode one chunk. `nodes` must be sorted and within [lo, hi); `neighbours`
+    holds the matching neighbour IDs, sorted within each node.
+    """
+    counts = np.bincount(np.asarray(nodes, dtype=np.int64) - lo, minlength=hi - lo).astype(np.uint64)
+    out = np.empty(counts.size + len(neighbours), dtype="<u8")
+
+    # Each node's count is followed by its neighbours, so count i sits after i counts and the neighbours before it
+    count_positions = np.arange(counts.size, dtype=np.int64)
+    count_positions[1:] += np.cumsum(counts[:-1], dtype=np.int64)
+    is_count = np.zeros(out.size, dtype=bool)
+    is_count[count_positions] = True
+
+    out[is_count] = counts
+    out[~is_count] = neighbours
+    return out
+
+
+def write_chunk(directory, direction, lo, hi, nodes, neighbours):
+    """Encode and write one chunk file, returning its path"""
+    path = os.path.join(directory, chunk_file_name(direction, lo, hi))
+    encode_chunk(lo, hi, nodes, neighbours).tofile(path)
+    return path
+
+
+def find_chunks(directory, direction, num_nodes):
+    """
+    List the (lo, hi, path) chunks of one dataset in a serialized directory.
+    A directory may hold several datasets, so only the chunks tiling exactly
+    [0, num_nodes) are returned.
+    """
+    by_lo = {}
+    for name in os.listdir(directory):
+        parts = name[:-len(".bin")].split("_") if name.endswith(".bin") else []
+        if len(parts) == 3 and parts[0] == direction and parts[1].isdigit() and parts[2].isdigit():
+            by_lo.setdefault(int(parts[1]), []).append((int(parts[2]), os.path.join(directory, name)))
+
+    def tile(lo):
+        if lo == num_nodes:
+            return []
+        for hi, path in sorted(by_lo.get(lo, [])):
+            if hi <= num_nodes:
+                rest = tile(hi)
+                if rest is not None:
+                    return [(lo, hi, path)] + rest
+        return None
+
+    chunks = tile(0)
+    if chunks is None:
+        raise FileNotFoundError(f"No {direction} chunks covering [0, {num_nodes}) in {directory}")
+    return chunks
+
+
+def read_chunk(path, lo, hi):
+    """Decode one chunk file into per-node neighbour counts and the concatenated neighbour IDs"""
+    values = np.fromfile(path, dtype="<u8")
+    count_positions = np.empty(hi - lo, dtype=np.int64)
+    position = 0
+    for i in range(hi - lo):
+        count_positions[i] = position
+        position += 1 + int(values[position])
+
+    is_count = np.zeros(values.size, dtype=bool)
+    is_count[count_positions] = True
+    return values[count_positions].astype(np.int64), values[~is_count].astype(np.int64)